@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,6 +14,14 @@
 #include <readline/readline.h>
 #include <readline/history.h>
 #include <math.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <errno.h>
 
 #define MAX_CMD_LENGTH 1024
 #define MAX_CMDS 2048
@@ -20,6 +29,25 @@
 #define MAX_RECOMMENDATIONS 100
 #define HISTORY_FILE ".dwimsh_history"
 #define LEVENSHTEIN_THRESHOLD 0.4
+#define GLOB_PATH_MAX 4096
+#define GLOB_DIR_BUFFER_SIZE 65536
+#define GLOB_CACHE_SIZE 256
+#define GLOB_ARENA_CHUNK 65536
+#define MAX_GLOB_SEGMENTS 128
+#define MAX_BRACE_EXPANSIONS 4096
+#define MAX_NAME_LENGTH 256
+#define TRIGRAM_SIZE 3
+#define TRIGRAM_OVERLAP_RATIO 0.6
+#define TRIGRAM_MIN_SHARED 3
+#define OVERLAP_MAX_EDITS 1
+#define HISTORY_RECALL_SIZE 1000
+#define HISTORY_INDEX_BATCH 4096
+#define HISTORY_MERGE_RATIO 8
+#define HISTORY_RMQ_BLOCK 64
+#define HISTORY_RMQ_LEVELS 8
+#define HISTORY_SEARCH_PAGE 16
+#define HISTORY_BLOCK_SIZE 4096
+#define HISTORY_MAX_BLOCKS 16384
 
 // ANSI color codes
 #define COLOR_RED     "\x1b[31m"
@@ -36,17 +64,198 @@ typedef struct {
     int count;
 } CommandTable;
 
+// Raw directory record as returned by getdents64
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// Bump allocator for strings produced while expanding one input line
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t used;
+    size_t size;
+    char data[];
+} ArenaChunk;
+
+typedef struct {
+    ArenaChunk *head;
+} Arena;
+
+// Expanded argument vector (always NULL-terminated)
+typedef struct {
+    char **argv;
+    int count;
+    int capacity;
+    Arena arena;
+} GlobResult;
+
+// One entry of a directory listing, indexing into the listing's name buffer
+typedef struct {
+    unsigned int offset;
+    unsigned short length;
+    unsigned char type;
+} DirEntryRef;
+
+typedef struct {
+    char *path;
+    unsigned long hash;
+    char *names;
+    size_t namesSize;
+    size_t namesCapacity;
+    DirEntryRef *entries;
+    int count;
+    int capacity;
+    int valid;
+    int cached;
+} DirListing;
+
+// Directory listings read while expanding the current line
+typedef struct {
+    DirListing *listings[GLOB_CACHE_SIZE];
+    int count;
+} DirListingCache;
+
+// Compiled glob operations for one path segment
+enum { GLOB_OP_CHAR, GLOB_OP_ANY, GLOB_OP_STAR, GLOB_OP_CLASS };
+
+typedef struct {
+    unsigned char type;
+    unsigned char ch;
+    unsigned short classIndex;
+} GlobOp;
+
+typedef struct {
+    GlobOp *ops;
+    int opCount;
+    unsigned char (*classes)[32];
+    char *literal;
+    int hasMeta;
+    int isGlobStar;
+    int matchesDot;
+} GlobSegment;
+
+typedef struct {
+    GlobSegment segments[MAX_GLOB_SEGMENTS];
+    int segmentCount;
+    int absolute;
+    int trailingSlash;
+} GlobPattern;
+
+typedef struct {
+    GlobResult *result;
+    DirListingCache *cache;
+    GlobPattern *pattern;
+    int expansionCount;     // words produced from the current token
+    int overflow;           // set once a token expands to too many words
+} GlobContext;
+
+// Trigram posting lists and name-length buckets over the command table
+typedef struct {
+    uint32_t *keys;                           // distinct trigrams, sorted
+    int *offsets;                             // keyCount + 1 offsets into postings
+    int *postings;                            // command indices, ascending per trigram
+    int keyCount;
+    int *lengthOrder;                         // command indices grouped by name length
+    int lengthOffsets[MAX_NAME_LENGTH + 1];   // bucket boundaries into lengthOrder
+    unsigned int *marks;                      // per-command stamp: already recommended
+    int *hits;                                // per-command shared trigram counters
+    unsigned int generation;
+} CommandIndex;
+
+// One history entry; text points into the loaded file contents or into a heap copy
+typedef struct {
+    const char *text;
+    int length;
+} HistoryLine;
+
+// Suffix array over the distinct history lines of entries [firstEntry, coveredEntries)
+typedef struct {
+    char *text;              // distinct lines, each terminated by '\n'
+    int *suffixes;           // sorted suffix start offsets into text
+    int suffixCount;
+    int *lineStarts;         // start offset of each distinct line (lines are stored newest first)
+    int *lineEntry;          // newest entry number of each distinct line
+    int *levels[HISTORY_RMQ_LEVELS];     // levels[0] = suffixes, then minimums of HISTORY_RMQ_BLOCK-sized blocks
+    int levelSizes[HISTORY_RMQ_LEVELS];
+    int levelCount;
+    int lineCount;
+    int firstEntry;
+    int coveredEntries;
+    unsigned int *marks;     // per-line stamp used to report a line once per search
+    unsigned int generation;
+} HistoryIndex;
+
+// Unbounded append-only history with a background-built index
+typedef struct {
+    int fd;
+    char *loaded;            // private copy of the file as read at startup
+    size_t loadedSize;
+    HistoryLine *blocks[HISTORY_MAX_BLOCKS];
+    int count;
+    HistoryIndex *base;      // published indexes, guarded by lock: base covers [0, base->coveredEntries)
+    HistoryIndex *delta;     // and delta the entries after it, so appends only reindex the recent part
+    pthread_mutex_t lock;
+    pthread_t builder;
+    int builderStarted;
+    int building;
+    int buildFirstEntry;     // 0 for a full rebuild, otherwise the start of the delta being built
+    atomic_int cancelBuild;
+} HistoryStore;
+
 CommandTable cmdTable;
+CommandIndex cmdIndex;
+DirListingCache globCache;
 char *homeDir;
 char historyFilePath[MAX_PATH_LENGTH];
+HistoryStore historyStore = { .fd = -1 };
 int interactive = 1;
+volatile sig_atomic_t terminateRequested = 0;
 
 // Function declarations
 void LoadCommands();
 int IsCommandInTable(const char *cmd);
 void FreeCommandsMemory();
+uint32_t TrigramKey(const char *s);
+int CompareTrigramPairs(const void *a, const void *b);
+void BuildCommandIndex();
+void FreeCommandIndex();
+const int *FindPostingList(uint32_t key, int *size);
+int FindSubstringCandidates(const char *cmd, int *candidates);
+int CompareTrigramHits(const void *a, const void *b);
+int FindTrigramOverlapCandidates(const char *cmd, int *candidates);
+int IsLengthSimilar(int len_cmd, int len_table);
+int BagDistance(int *queryCounts, int len_cmd, const char *name, int len_table);
+int SubstringEditDistance(const char *pattern, const char *text);
+void AddRecommendation(int index, char **recommendations, int *recommendationCount);
 void TokenizeUserInput(char *command, char **tokens, int *tokenCount);
 void PrintTokens(char **tokens, int tokenCount);
+void *ArenaAlloc(Arena *arena, size_t size);
+char *ArenaStrndup(Arena *arena, const char *str, size_t len);
+void ArenaFree(Arena *arena);
+void AppendGlobResult(GlobResult *result, char *word);
+void FreeGlobResult(GlobResult *result);
+unsigned long HashString(const char *str);
+DirListing *ReadDirListing(const char *path);
+void FreeDirListing(DirListing *listing);
+DirListing *AcquireDirListing(DirListingCache *cache, const char *path);
+void ReleaseDirListing(DirListing *listing);
+void ClearDirListingCache(DirListingCache *cache);
+int IsDirectoryEntry(const char *path, unsigned char type, int followLinks);
+int ParseGlobClass(const char *s, int start, int len, unsigned char *bitmap);
+int CompileGlobSegment(const char *s, int len, GlobSegment *seg, Arena *arena);
+int CompileGlobPattern(const char *pattern, GlobPattern *out, Arena *arena);
+int GlobMatchSegment(const GlobSegment *seg, const char *name, int len);
+int HasGlobMeta(const char *word);
+void AddGlobMatch(GlobContext *ctx, const char *path, size_t pathLen);
+void GlobWalk(GlobContext *ctx, int segIndex, char *path, size_t pathLen);
+int CompareStrings(const void *a, const void *b);
+void ExpandGlobWord(GlobContext *ctx, const char *word);
+void ExpandBraces(GlobContext *ctx, const char *word);
+int ExpandTokens(char **tokens, int tokenCount, GlobResult *result);
 int HammingDistance(const char *str1, const char *str2);
 int LevenshteinDistance(const char *s1, const char *s2);
 int AreAnagrams(const char *str1, const char *str2);
@@ -59,8 +268,35 @@ int IsBuiltInCommand(const char *cmd);
 int IsYesResponse(const char *response);
 int IsNoResponse(const char *response);
 void HandleSignal(int sig);
+int CheckTerminateRequest();
 void InitHistory();
-void SaveHistory();
+void CloseHistory();
+HistoryLine *GetHistoryLine(int entry);
+int SearchableLength(const HistoryLine *line);
+int PushHistoryLine(const char *text, int length);
+void OpenHistoryStore(const char *path);
+void AddHistoryLine(const char *input);
+int SuffixChar(const char *text, int pos, int depth);
+int CompareSuffixes(const char *text, int a, int b, int depth);
+void SortSuffixes(const char *text, int *sa, int n, int depth);
+HistoryIndex *BuildHistoryIndex(int firstEntry, int coveredEntries);
+int SearchHistoryIndex(HistoryIndex *index, const char *pattern, int length, int **matches, int *count, int *capacity);
+void FindSuffixRange(const HistoryIndex *index, const char *pattern, int length, int *first, int *last);
+int RangeArgMin(const HistoryIndex *index, int level, int lo, int hi);
+int IsDuplicateMatch(const int *matches, int count, int entry);
+int SearchHistoryIndexNewest(HistoryIndex *index, const char *pattern, int length, int *matches, int count, int limit);
+int SearchHistoryNewest(const char *pattern, int limit, int **results);
+void FreeHistoryIndex(HistoryIndex *index);
+void *HistoryIndexThread(void *arg);
+void StartHistoryIndexBuild(int minUnindexed);
+int CompareSuffixPrefix(const char *text, int pos, const char *pattern, int length);
+int FindIndexLine(const HistoryIndex *index, int pos);
+int CompareHistoryContent(const void *a, const void *b);
+int CompareEntriesDescending(const void *a, const void *b);
+int SearchHistory(const char *pattern, int **results);
+void PrintHistory(const char *pattern);
+int HistorySearchKey(int count, int key);
+void InitializeHistorySearch();
 void PrintWelcomeMessage();
 void PrintHelpMessage();
 void Cleanup();
@@ -80,215 +316,1921 @@ void HandleSignal(int sig) {
             fflush(stdout);
         }
     } else if (sig == SIGTERM) {
-        Cleanup();
-        exit(0);
+        // Only flag it: the history lock may be held by the interrupted code,
+        // so cleanup runs from the main loop instead
+        terminateRequested = 1;
     }
 }
 
+// Readline hook for interrupted reads: finish the current line once SIGTERM has been received
+int CheckTerminateRequest() {
+    if (terminateRequested)
+        rl_done = 1;
+    return 0;
+}
+
 // Initialize command history
 void InitHistory() {
     struct passwd *pw = getpwuid(getuid());
     homeDir = pw->pw_dir;
-    
+
     snprintf(historyFilePath, MAX_PATH_LENGTH, "%s/%s", homeDir, HISTORY_FILE);
-    
+
+    pthread_mutex_init(&historyStore.lock, NULL);
+    OpenHistoryStore(historyFilePath);
+
+    // Readline only keeps the most recent lines for up/down navigation; the full history lives in the store
     using_history();
-    read_history(historyFilePath);
-    stifle_history(1000);  // Limit history to 1000 entries
+    int first = historyStore.count > HISTORY_RECALL_SIZE ? historyStore.count - HISTORY_RECALL_SIZE : 0;
+    for (int i = first; i < historyStore.count; i++) {
+        HistoryLine *line = GetHistoryLine(i);
+        char *copy = strndup(line->text, line->length);
+        if (copy != NULL) {
+            add_history(copy);
+            free(copy);
+        }
+    }
+    stifle_history(HISTORY_RECALL_SIZE);
+
+    StartHistoryIndexBuild(1);
 }
 
-// Save command history
-void SaveHistory() {
-    write_history(historyFilePath);
+// Stop the index builder and release the history store
+void CloseHistory() {
+    atomic_store(&historyStore.cancelBuild, 1);
+    if (historyStore.builderStarted) {
+        pthread_join(historyStore.builder, NULL);
+        historyStore.builderStarted = 0;
+    }
+
+    FreeHistoryIndex(historyStore.base);
+    FreeHistoryIndex(historyStore.delta);
+    historyStore.base = NULL;
+    historyStore.delta = NULL;
+
+    // Entries outside the loaded file contents are heap copies made by AddHistoryLine
+    for (int i = 0; i < historyStore.count; i++) {
+        HistoryLine *line = GetHistoryLine(i);
+        if (historyStore.loaded == NULL || line->text < historyStore.loaded ||
+            line->text >= historyStore.loaded + historyStore.loadedSize)
+            free((char *)line->text);
+    }
+    for (int b = 0; b < HISTORY_MAX_BLOCKS && historyStore.blocks[b] != NULL; b++) {
+        free(historyStore.blocks[b]);
+        historyStore.blocks[b] = NULL;
+    }
+    historyStore.count = 0;
+
+    free(historyStore.loaded);
+    historyStore.loaded = NULL;
+    historyStore.loadedSize = 0;
+
+    if (historyStore.fd >= 0)
+        close(historyStore.fd);
+    historyStore.fd = -1;
 }
 
-// Print welcome message with ASCII art
-void PrintWelcomeMessage() {
-    printf("\n");
-    printf(COLOR_GREEN "██████╗ ██╗    ██╗██╗███╗   ███╗███████╗██╗  ██╗\n");
-                printf("██╔══██╗██║    ██║██║████╗ ████║██╔════╝██║  ██║\n");
-                printf("██║  ██║██║ █╗ ██║██║██╔████╔██║███████╗███████║\n");
-                printf("██║  ██║██║███╗██║██║██║╚██╔╝██║╚════██║██╔══██║\n");
-                printf("██████╔╝╚███╔███╔╝██║██║ ╚═╝ ██║███████║██║  ██║\n");
-                printf("╚═════╝  ╚══╝╚══╝ ╚═╝╚═╝     ╚═╝╚══════╝╚═╝  ╚═╝\n" COLOR_RESET);
-    printf(COLOR_GREEN "Do What I Mean Shell - Linux Edition v1.0\n" COLOR_RESET);
-    printf(COLOR_GREEN "WRITTEN BY VICTOR ROMERO - 12211079\n\n" COLOR_RESET);
-    printf(COLOR_YELLOW "Type 'help' for available commands or 'exit' to quit\n" COLOR_RESET);
-    printf("\n");
+// Get a history entry by number (0 is the oldest)
+HistoryLine *GetHistoryLine(int entry) {
+    return &historyStore.blocks[entry / HISTORY_BLOCK_SIZE][entry % HISTORY_BLOCK_SIZE];
 }
 
-// Print help message
-void PrintHelpMessage() {
-    printf("\n%sDWIMSH - Do What I Mean Shell%s\n\n", COLOR_BOLD, COLOR_RESET);
-    printf("Built-in commands:\n");
-    printf("  %sexit%s          - Exit the shell\n", COLOR_BOLD, COLOR_RESET);
-    printf("  %shelp%s          - Display this help message\n", COLOR_BOLD, COLOR_RESET);
-    printf("  %sclear%s         - Clear the screen\n", COLOR_BOLD, COLOR_RESET);
-    printf("  %slist%s          - List all available commands\n", COLOR_BOLD, COLOR_RESET);
-    printf("  %shistory%s       - Show command history\n", COLOR_BOLD, COLOR_RESET);
-    printf("\n");
-    printf("Features:\n");
-    printf("  - Command correction using Hamming distance\n");
-    printf("  - Command correction using Levenshtein distance\n");
-    printf("  - Command correction using anagram detection\n");
-    printf("  - Command history with up/down arrow keys\n");
-    printf("  - Tab completion for commands\n");
-    printf("\n");
+// Length of the part of a line that searches look at: only the first MAX_CMD_LENGTH bytes are
+// indexed (keeping the suffix sort shallow), so unindexed lines are cut the same way
+int SearchableLength(const HistoryLine *line) {
+    return line->length < MAX_CMD_LENGTH ? line->length : MAX_CMD_LENGTH;
+}
+
+// Append an entry to the in-memory history; blocks never move, so the builder thread can read them
+int PushHistoryLine(const char *text, int length) {
+    int block = historyStore.count / HISTORY_BLOCK_SIZE;
+    if (block >= HISTORY_MAX_BLOCKS)
+        return 0;
+
+    if (historyStore.blocks[block] == NULL) {
+        historyStore.blocks[block] = malloc(HISTORY_BLOCK_SIZE * sizeof(HistoryLine));
+        if (historyStore.blocks[block] == NULL)
+            return 0;
+    }
+
+    HistoryLine *line = &historyStore.blocks[block][historyStore.count % HISTORY_BLOCK_SIZE];
+    line->text = text;
+    line->length = length;
+    historyStore.count++;
+    return 1;
+}
+
+// Open the append-only history file and load its current contents
+void OpenHistoryStore(const char *path) {
+    historyStore.fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (historyStore.fd < 0)
+        return;
+
+    struct stat st;
+    if (fstat(historyStore.fd, &st) != 0 || st.st_size == 0)
+        return;
+
+    // Read into a private buffer rather than mapping the file: another shell may truncate or
+    // rewrite it, and a shrunken mapping would fault (SIGBUS) on the next search
+    char *loaded = malloc(st.st_size);
+    if (loaded == NULL)
+        return;
+
+    size_t size = 0;
+    while (size < (size_t)st.st_size) {
+        ssize_t nread = pread(historyStore.fd, loaded + size, st.st_size - size, size);
+        if (nread < 0 && errno == EINTR)
+            continue;
+        if (nread <= 0)
+            break;
+        size += nread;
+    }
+    if (size == 0) {
+        free(loaded);
+        return;
+    }
+    historyStore.loaded = loaded;
+    historyStore.loadedSize = size;
+
+    // Entries point straight into the loaded buffer
+    char *end = loaded + size;
+    char *start = loaded;
+    while (start < end) {
+        char *newline = memchr(start, '\n', end - start);
+        char *lineEnd = newline ? newline : end;
+        if (lineEnd > start)
+            PushHistoryLine(start, lineEnd - start);
+        start = lineEnd + 1;
+    }
+
+    // Make sure the next appended entry starts on its own line
+    if (loaded[size - 1] != '\n') {
+        if (write(historyStore.fd, "\n", 1) < 0)
+            perror("History write error");
+    }
+}
+
+// Record a line in readline's recall list and append it to the history file
+void AddHistoryLine(const char *input) {
+    add_history(input);
+
+    int length = strlen(input);
+    char *text = strdup(input);
+    if (text == NULL || !PushHistoryLine(text, length)) {
+        free(text);
+        return;
+    }
+
+    if (historyStore.fd >= 0) {
+        struct iovec iov[2] = {
+            { (void *)input, length },
+            { "\n", 1 }
+        };
+        if (writev(historyStore.fd, iov, 2) < 0)
+            perror("History write error");
+    }
+
+    // Reindex in the background once the unindexed tail gets long
+    StartHistoryIndexBuild(HISTORY_INDEX_BATCH);
+}
+
+// Character of a suffix at a given depth; the end of its line sorts first
+int SuffixChar(const char *text, int pos, int depth) {
+    unsigned char c = text[pos + depth];
+    return c == '\n' ? 0 : c;
+}
+
+// Compare two suffixes that are known to be equal up to depth
+int CompareSuffixes(const char *text, int a, int b, int depth) {
+    for (;; depth++) {
+        int ca = SuffixChar(text, a, depth);
+        int cb = SuffixChar(text, b, depth);
+        if (ca != cb || ca == 0)
+            return ca - cb;
+    }
+}
+
+// Sort suffixes with multikey quicksort, comparing only up to the end of each line
+void SortSuffixes(const char *text, int *sa, int n, int depth) {
+    while (n > 1) {
+        if (atomic_load(&historyStore.cancelBuild))
+            return;
+
+        if (n < 16) {
+            for (int i = 1; i < n; i++) {
+                int value = sa[i];
+                int j = i;
+                while (j > 0 && CompareSuffixes(text, sa[j - 1], value, depth) > 0) {
+                    sa[j] = sa[j - 1];
+                    j--;
+                }
+                sa[j] = value;
+            }
+            return;
+        }
+
+        // Three-way partition on the character at the current depth
+        int pivot = SuffixChar(text, sa[n / 2], depth);
+        int lt = 0, gt = n - 1, i = 0;
+        while (i <= gt) {
+            int c = SuffixChar(text, sa[i], depth);
+            if (c < pivot) {
+                int tmp = sa[lt]; sa[lt++] = sa[i]; sa[i++] = tmp;
+            } else if (c > pivot) {
+                int tmp = sa[gt]; sa[gt--] = sa[i]; sa[i] = tmp;
+            } else {
+                i++;
+            }
+        }
+
+        // Lines are truncated when indexed, so this recursion is bounded by MAX_CMD_LENGTH
+        if (pivot != 0)
+            SortSuffixes(text, sa + lt, gt - lt + 1, depth + 1);
+
+        // Recurse into the smaller side and loop on the larger one
+        int greater = n - gt - 1;
+        if (lt < greater) {
+            SortSuffixes(text, sa, lt, depth);
+            sa += gt + 1;
+            n = greater;
+        } else {
+            SortSuffixes(text, sa + gt + 1, greater, depth);
+            n = lt;
+        }
+    }
+}
+
+// Build a suffix array over the distinct lines of history entries [firstEntry, coveredEntries)
+HistoryIndex *BuildHistoryIndex(int firstEntry, int coveredEntries) {
+    HistoryIndex *index = calloc(1, sizeof(HistoryIndex));
+    if (index == NULL)
+        return NULL;
+    index->firstEntry = firstEntry;
+    index->coveredEntries = coveredEntries;
+    int entryCount = coveredEntries - firstEntry;
+
+    // Deduplicate lines with an open-addressing table, remembering each line's latest entry
+    size_t tableSize = 16;
+    while (tableSize < (size_t)entryCount * 2)
+        tableSize *= 2;
+    int *table = malloc(tableSize * sizeof(int));
+    int *lineFirst = malloc((entryCount + 1) * sizeof(int));
+    index->lineEntry = malloc((entryCount + 1) * sizeof(int));
+    index->lineStarts = malloc((entryCount + 1) * sizeof(int));
+
+    if (table == NULL || lineFirst == NULL || index->lineEntry == NULL || index->lineStarts == NULL) {
+        free(table);
+        free(lineFirst);
+        FreeHistoryIndex(index);
+        return NULL;
+    }
+    memset(table, -1, tableSize * sizeof(int));
+
+    size_t textSize = 0;
+    // Walk newest to oldest so line ids (and text order) follow recency
+    for (int e = coveredEntries - 1; e >= firstEntry; e--) {
+        HistoryLine *line = GetHistoryLine(e);
+        int length = SearchableLength(line);
+
+        unsigned long hash = 5381;
+        for (int i = 0; i < length; i++) {
+            hash = hash * 33 + (unsigned char)line->text[i];
+        }
+
+        size_t slot = hash & (tableSize - 1);
+        while (table[slot] >= 0) {
+            HistoryLine *other = GetHistoryLine(lineFirst[table[slot]]);
+            if (SearchableLength(other) == length && memcmp(other->text, line->text, length) == 0)
+                break;
+            slot = (slot + 1) & (tableSize - 1);
+        }
+
+        if (table[slot] < 0) {
+            table[slot] = index->lineCount;
+            lineFirst[index->lineCount] = e;
+            index->lineEntry[index->lineCount] = e;
+            index->lineCount++;
+            textSize += length + 1;
+        }
+    }
+    free(table);
+
+    // Concatenate the distinct lines, each terminated by '\n'
+    index->text = malloc(textSize + 1);
+    index->suffixes = malloc((textSize + 1) * sizeof(int));
+    index->marks = calloc(index->lineCount + 1, sizeof(unsigned int));
+    if (index->text == NULL || index->suffixes == NULL || index->marks == NULL) {
+        free(lineFirst);
+        FreeHistoryIndex(index);
+        return NULL;
+    }
+
+    size_t offset = 0;
+    for (int l = 0; l < index->lineCount; l++) {
+        HistoryLine *line = GetHistoryLine(lineFirst[l]);
+        int length = SearchableLength(line);
+
+        index->lineStarts[l] = offset;
+        memcpy(index->text + offset, line->text, length);
+        for (int i = 0; i < length; i++) {
+            index->suffixes[index->suffixCount++] = offset + i;
+        }
+        offset += length;
+        index->text[offset++] = '\n';
+    }
+    index->text[offset] = '\0';
+    free(lineFirst);
+
+    SortSuffixes(index->text, index->suffixes, index->suffixCount, 0);
+
+    if (atomic_load(&historyStore.cancelBuild)) {
+        FreeHistoryIndex(index);
+        return NULL;
+    }
+
+    // Block minimums over the suffix array; a smaller text offset means a newer line
+    index->levels[0] = index->suffixes;
+    index->levelSizes[0] = index->suffixCount;
+    index->levelCount = 1;
+    while (index->levelCount < HISTORY_RMQ_LEVELS && index->levelSizes[index->levelCount - 1] > HISTORY_RMQ_BLOCK) {
+        const int *below = index->levels[index->levelCount - 1];
+        int belowSize = index->levelSizes[index->levelCount - 1];
+        int size = (belowSize + HISTORY_RMQ_BLOCK - 1) / HISTORY_RMQ_BLOCK;
+        int *level = malloc(size * sizeof(int));
+        if (level == NULL)
+            break;
+
+        for (int b = 0; b < size; b++) {
+            int end = (b + 1) * HISTORY_RMQ_BLOCK < belowSize ? (b + 1) * HISTORY_RMQ_BLOCK : belowSize;
+            int min = below[b * HISTORY_RMQ_BLOCK];
+            for (int i = b * HISTORY_RMQ_BLOCK + 1; i < end; i++) {
+                if (below[i] < min)
+                    min = below[i];
+            }
+            level[b] = min;
+        }
+
+        index->levels[index->levelCount] = level;
+        index->levelSizes[index->levelCount] = size;
+        index->levelCount++;
+    }
+    return index;
+}
+
+// Free a history index
+void FreeHistoryIndex(HistoryIndex *index) {
+    if (index == NULL)
+        return;
+    free(index->text);
+    free(index->suffixes);
+    free(index->lineStarts);
+    free(index->lineEntry);
+    free(index->marks);
+    for (int l = 1; l < index->levelCount; l++) {
+        free(index->levels[l]);
+    }
+    free(index);
+}
+
+// Builder thread: index a snapshot of the history, then publish it as the new base or delta
+void *HistoryIndexThread(void *arg) {
+    int coveredEntries = (int)(intptr_t)arg;
+    int firstEntry = historyStore.buildFirstEntry;
+    HistoryIndex *index = BuildHistoryIndex(firstEntry, coveredEntries);
+
+    pthread_mutex_lock(&historyStore.lock);
+    HistoryIndex *oldBase = NULL, *oldDelta = NULL;
+    if (index != NULL) {
+        oldDelta = historyStore.delta;
+        historyStore.delta = NULL;
+        if (firstEntry == 0) {
+            oldBase = historyStore.base;
+            historyStore.base = index;
+        } else {
+            historyStore.delta = index;
+        }
+    }
+    historyStore.building = 0;
+    pthread_mutex_unlock(&historyStore.lock);
+
+    // Searches hold the lock, so nobody can still be reading the old indexes
+    FreeHistoryIndex(oldBase);
+    FreeHistoryIndex(oldDelta);
+    return NULL;
+}
+
+// Update the history index in the background once at least minUnindexed entries are not covered.
+// New entries are indexed into a small delta after the base index; the base is only rebuilt
+// from scratch once the delta would exceed 1/HISTORY_MERGE_RATIO of it.
+void StartHistoryIndexBuild(int minUnindexed) {
+    pthread_mutex_lock(&historyStore.lock);
+    HistoryIndex *base = historyStore.base;
+    int baseCovered = base ? base->coveredEntries : 0;
+    int covered = historyStore.delta ? historyStore.delta->coveredEntries : baseCovered;
+    if (historyStore.building || historyStore.count - covered < minUnindexed) {
+        pthread_mutex_unlock(&historyStore.lock);
+        return;
+    }
+    historyStore.building = 1;
+    if (base == NULL || historyStore.count - baseCovered > baseCovered / HISTORY_MERGE_RATIO)
+        historyStore.buildFirstEntry = 0;
+    else
+        historyStore.buildFirstEntry = baseCovered;
+    pthread_mutex_unlock(&historyStore.lock);
+
+    if (historyStore.builderStarted)
+        pthread_join(historyStore.builder, NULL);
+
+    // The builder inherits the signal mask, so block everything and let the main thread handle signals
+    sigset_t allSignals, oldSignals;
+    sigfillset(&allSignals);
+    pthread_sigmask(SIG_SETMASK, &allSignals, &oldSignals);
+
+    historyStore.builderStarted = (pthread_create(&historyStore.builder, NULL, HistoryIndexThread,
+                                                  (void *)(intptr_t)historyStore.count) == 0);
+
+    pthread_sigmask(SIG_SETMASK, &oldSignals, NULL);
+
+    if (!historyStore.builderStarted)
+        historyStore.building = 0;
+}
+
+// Compare a pattern with the suffix at pos; returns 0 when the suffix starts with the pattern
+int CompareSuffixPrefix(const char *text, int pos, const char *pattern, int length) {
+    for (int i = 0; i < length; i++) {
+        int c = SuffixChar(text, pos, i);
+        if ((unsigned char)pattern[i] != c)
+            return (unsigned char)pattern[i] - c;
+    }
+    return 0;
+}
+
+// Find the distinct line that contains a text offset
+int FindIndexLine(const HistoryIndex *index, int pos) {
+    int low = 0, high = index->lineCount - 1;
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (index->lineStarts[mid] <= pos)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+    return low;
+}
+
+// Order matches by searchable content, newest entry first among equal lines
+int CompareHistoryContent(const void *a, const void *b) {
+    HistoryLine *x = GetHistoryLine(*(const int *)a);
+    HistoryLine *y = GetHistoryLine(*(const int *)b);
+    int xLength = SearchableLength(x), yLength = SearchableLength(y);
+    int cmp = memcmp(x->text, y->text, xLength < yLength ? xLength : yLength);
+    if (cmp != 0)
+        return cmp;
+    if (xLength != yLength)
+        return xLength - yLength;
+    return *(const int *)b - *(const int *)a;
+}
+
+// Order entry numbers newest first
+int CompareEntriesDescending(const void *a, const void *b) {
+    return *(const int *)b - *(const int *)a;
+}
+
+// Suffixes starting with the pattern form one contiguous range [first, last) of the suffix array
+void FindSuffixRange(const HistoryIndex *index, const char *pattern, int length, int *first, int *last) {
+    int low = 0, high = index->suffixCount;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (CompareSuffixPrefix(index->text, index->suffixes[mid], pattern, length) > 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    *first = low;
+    high = index->suffixCount;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (CompareSuffixPrefix(index->text, index->suffixes[mid], pattern, length) >= 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    *last = low;
+}
+
+// Position in levels[level] of the smallest value over [lo, hi), using the block minimums above it
+int RangeArgMin(const HistoryIndex *index, int level, int lo, int hi) {
+    const int *values = index->levels[level];
+    int loBlock = (lo + HISTORY_RMQ_BLOCK - 1) / HISTORY_RMQ_BLOCK;
+    int hiBlock = hi / HISTORY_RMQ_BLOCK;
+    int best = lo;
+
+    if (level + 1 >= index->levelCount || loBlock >= hiBlock) {
+        for (int i = lo + 1; i < hi; i++) {
+            if (values[i] < values[best])
+                best = i;
+        }
+        return best;
+    }
+
+    // Scan the partial blocks at both ends, then ask the level above for the whole blocks
+    for (int i = lo; i < loBlock * HISTORY_RMQ_BLOCK; i++) {
+        if (values[i] < values[best])
+            best = i;
+    }
+    for (int i = hiBlock * HISTORY_RMQ_BLOCK; i < hi; i++) {
+        if (values[i] < values[best])
+            best = i;
+    }
+
+    int block = RangeArgMin(index, level + 1, loBlock, hiBlock);
+    int blockMin = index->levels[level + 1][block];
+    if (blockMin < values[best]) {
+        int end = (block + 1) * HISTORY_RMQ_BLOCK < index->levelSizes[level] ? (block + 1) * HISTORY_RMQ_BLOCK : index->levelSizes[level];
+        for (int i = block * HISTORY_RMQ_BLOCK; i < end; i++) {
+            if (values[i] == blockMin) {
+                best = i;
+                break;
+            }
+        }
+    }
+    return best;
+}
+
+// Check if an entry repeats the searchable text of a match already collected
+int IsDuplicateMatch(const int *matches, int count, int entry) {
+    HistoryLine *line = GetHistoryLine(entry);
+    int length = SearchableLength(line);
+    for (int i = 0; i < count; i++) {
+        HistoryLine *other = GetHistoryLine(matches[i]);
+        if (SearchableLength(other) == length && memcmp(other->text, line->text, length) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+// Add the newest matching lines of an index to matches until it holds limit entries.
+// Suffixes are taken in increasing text offset, i.e. newest line first, so only
+// about limit range-minimum queries are needed however many lines match.
+int SearchHistoryIndexNewest(HistoryIndex *index, const char *pattern, int length, int *matches, int count, int limit) {
+    if (index == NULL || length > MAX_CMD_LENGTH || count >= limit)
+        return count;
+
+    int first, last;
+    FindSuffixRange(index, pattern, length, &first, &last);
+    if (first >= last)
+        return count;
+
+    // Pending subranges of [first, last) and the position of their minimum
+    int capacity = 2 * limit + 2;
+    int (*ranges)[3] = malloc(capacity * sizeof(*ranges));
+    if (ranges == NULL)
+        return count;
+
+    int rangeCount = 1;
+    ranges[0][0] = first;
+    ranges[0][1] = last;
+    ranges[0][2] = RangeArgMin(index, 0, first, last);
+    int lastLine = -1;
+
+    while (rangeCount > 0 && count < limit) {
+        int r = 0;
+        for (int i = 1; i < rangeCount; i++) {
+            if (index->suffixes[ranges[i][2]] < index->suffixes[ranges[r][2]])
+                r = i;
+        }
+
+        int lo = ranges[r][0], hi = ranges[r][1], at = ranges[r][2];
+        int line = FindIndexLine(index, index->suffixes[at]);
+
+        // Occurrences of one line come out consecutively; report each line once
+        if (line != lastLine) {
+            lastLine = line;
+            if (!IsDuplicateMatch(matches, count, index->lineEntry[line]))
+                matches[count++] = index->lineEntry[line];
+        }
+
+        // Replace the range by the two halves around its minimum
+        ranges[r][0] = ranges[--rangeCount][0];
+        ranges[r][1] = ranges[rangeCount][1];
+        ranges[r][2] = ranges[rangeCount][2];
+        if (rangeCount + 2 > capacity) {
+            capacity *= 2;
+            int (*grown)[3] = realloc(ranges, capacity * sizeof(*ranges));
+            if (grown == NULL)
+                break;
+            ranges = grown;
+        }
+        if (lo < at) {
+            ranges[rangeCount][0] = lo;
+            ranges[rangeCount][1] = at;
+            ranges[rangeCount][2] = RangeArgMin(index, 0, lo, at);
+            rangeCount++;
+        }
+        if (at + 1 < hi) {
+            ranges[rangeCount][0] = at + 1;
+            ranges[rangeCount][1] = hi;
+            ranges[rangeCount][2] = RangeArgMin(index, 0, at + 1, hi);
+            rangeCount++;
+        }
+    }
+
+    free(ranges);
+    return count;
+}
+
+// Find the newest (at most limit) distinct history lines containing pattern, newest first
+int SearchHistoryNewest(const char *pattern, int limit, int **results) {
+    int length = strlen(pattern);
+    int *matches = malloc(limit * sizeof(int));
+    int count = 0;
+
+    *results = matches;
+    if (matches == NULL || length == 0)
+        return 0;
+
+    pthread_mutex_lock(&historyStore.lock);
+    HistoryIndex *base = historyStore.base;
+    HistoryIndex *delta = historyStore.delta;
+    int covered = delta ? delta->coveredEntries : base ? base->coveredEntries : 0;
+
+    // Unindexed entries are newer than anything indexed, and the delta is newer than the base
+    for (int e = historyStore.count - 1; e >= covered && count < limit; e--) {
+        HistoryLine *line = GetHistoryLine(e);
+        if (memmem(line->text, SearchableLength(line), pattern, length) != NULL && !IsDuplicateMatch(matches, count, e))
+            matches[count++] = e;
+    }
+    count = SearchHistoryIndexNewest(delta, pattern, length, matches, count, limit);
+    count = SearchHistoryIndexNewest(base, pattern, length, matches, count, limit);
+    pthread_mutex_unlock(&historyStore.lock);
+
+    return count;
+}
+
+// Append the newest entry of every distinct indexed line containing pattern to *matches
+int SearchHistoryIndex(HistoryIndex *index, const char *pattern, int length, int **matches, int *count, int *capacity) {
+    int before = *count;
+    if (index == NULL || length > MAX_CMD_LENGTH)
+        return 0;
+
+    int first, last;
+    FindSuffixRange(index, pattern, length, &first, &last);
+
+    if (++index->generation == 0) {
+        memset(index->marks, 0, index->lineCount * sizeof(unsigned int));
+        index->generation = 1;
+    }
+
+    for (int s = first; s < last; s++) {
+        int l = FindIndexLine(index, index->suffixes[s]);
+        if (index->marks[l] == index->generation)
+            continue;
+        index->marks[l] = index->generation;
+
+        if (*count == *capacity) {
+            int *grown = realloc(*matches, *capacity * 2 * sizeof(int));
+            if (grown == NULL)
+                break;
+            *matches = grown;
+            *capacity *= 2;
+        }
+        (*matches)[(*count)++] = index->lineEntry[l];
+    }
+    return *count - before;
+}
+
+// Find history entries containing pattern; returns distinct lines, newest first (caller frees *results)
+int SearchHistory(const char *pattern, int **results) {
+    int length = strlen(pattern);
+    int count = 0, capacity = 64;
+    int *matches = malloc(capacity * sizeof(int));
+
+    *results = matches;
+    if (matches == NULL || length == 0)
+        return 0;
+
+    pthread_mutex_lock(&historyStore.lock);
+    HistoryIndex *base = historyStore.base;
+    HistoryIndex *delta = historyStore.delta;
+    int covered = delta ? delta->coveredEntries : base ? base->coveredEntries : 0;
+
+    // Entries added since the last build are scanned directly; there are at most a few batches of them
+    for (int e = historyStore.count - 1; e >= covered; e--) {
+        HistoryLine *line = GetHistoryLine(e);
+        if (memmem(line->text, SearchableLength(line), pattern, length) == NULL)
+            continue;
+        if (count == capacity) {
+            int *grown = realloc(matches, capacity * 2 * sizeof(int));
+            if (grown == NULL)
+                break;
+            matches = grown;
+            capacity *= 2;
+        }
+        matches[count++] = e;
+    }
+
+    // Each index only holds distinct lines, so duplicates need the recent entries or both indexes
+    int tailCount = count;
+    int indexSources = (SearchHistoryIndex(delta, pattern, length, &matches, &count, &capacity) > 0) +
+                       (SearchHistoryIndex(base, pattern, length, &matches, &count, &capacity) > 0);
+    pthread_mutex_unlock(&historyStore.lock);
+
+    if (tailCount == 0 && indexSources <= 1) {
+        qsort(matches, count, sizeof(int), CompareEntriesDescending);
+        *results = matches;
+        return count;
+    }
+
+    // Keep only the newest entry of each line
+    qsort(matches, count, sizeof(int), CompareHistoryContent);
+    int unique = 0;
+    for (int i = 0; i < count; i++) {
+        if (unique > 0) {
+            HistoryLine *prev = GetHistoryLine(matches[unique - 1]);
+            HistoryLine *line = GetHistoryLine(matches[i]);
+            if (SearchableLength(prev) == SearchableLength(line) &&
+                memcmp(prev->text, line->text, SearchableLength(line)) == 0)
+                continue;
+        }
+        matches[unique++] = matches[i];
+    }
+    qsort(matches, unique, sizeof(int), CompareEntriesDescending);
+
+    *results = matches;
+    return unique;
+}
+
+// Print history entries; with a pattern, print the matching distinct lines oldest first
+void PrintHistory(const char *pattern) {
+    if (pattern == NULL || *pattern == '\0') {
+        int first = historyStore.count > HISTORY_RECALL_SIZE ? historyStore.count - HISTORY_RECALL_SIZE : 0;
+        for (int i = first; i < historyStore.count; i++) {
+            HistoryLine *line = GetHistoryLine(i);
+            printf("%5d  %.*s\n", i + 1, line->length, line->text);
+        }
+        return;
+    }
+
+    int *matches;
+    int count = SearchHistory(pattern, &matches);
+    for (int i = count - 1; i >= 0; i--) {
+        HistoryLine *line = GetHistoryLine(matches[i]);
+        printf("%5d  %.*s\n", matches[i] + 1, line->length, line->text);
+    }
+    free(matches);
+}
+
+// Ctrl-R: incremental reverse search; each keystroke only fetches the newest few matches
+int HistorySearchKey(int count, int key) {
+    char pattern[MAX_CMD_LENGTH] = "";
+    int patternLength = 0;
+    int *matches = NULL;
+    int matchCount = 0;
+    int matchLimit = HISTORY_SEARCH_PAGE;
+    int current = 0;
+    char *original = strdup(rl_line_buffer);
+
+    for (;;) {
+        HistoryLine *line = current < matchCount ? GetHistoryLine(matches[current]) : NULL;
+        rl_message("(%sreverse-i-search)`%s': %.*s",
+                   patternLength > 0 && line == NULL ? "failed " : "",
+                   pattern, line ? line->length : 0, line ? line->text : "");
+
+        int c = rl_read_key();
+
+        if (c == 18) {  // Ctrl-R: next older match, fetching more once the current page is used up
+            if (current + 1 >= matchCount && matchCount == matchLimit) {
+                free(matches);
+                matchLimit *= 2;
+                matchCount = SearchHistoryNewest(pattern, matchLimit, &matches);
+            }
+            if (current + 1 < matchCount)
+                current++;
+            else
+                rl_ding();
+            continue;
+        }
+
+        // Printable ASCII and UTF-8 bytes extend the pattern
+        int printable = (c >= 0 && c < 128 && isprint(c)) || (c >= 128 && c <= 255);
+
+        if (c == 127 || c == 8 || (printable && patternLength < MAX_CMD_LENGTH - 1)) {
+            if (c == 127 || c == 8) {
+                if (patternLength > 0)
+                    pattern[--patternLength] = '\0';
+            } else {
+                pattern[patternLength++] = c;
+                pattern[patternLength] = '\0';
+            }
+            free(matches);
+            matchLimit = HISTORY_SEARCH_PAGE;
+            matchCount = SearchHistoryNewest(pattern, matchLimit, &matches);
+            current = 0;
+            continue;
+        }
+
+        if (c < 0) {  // EOF or an interrupted read (e.g. SIGTERM): give up the search and the line
+            rl_replace_line(original ? original : "", 0);
+            rl_done = 1;
+        } else if (c == 7 || terminateRequested) {  // Ctrl-G: restore the original line
+            rl_replace_line(original ? original : "", 0);
+        } else {
+            // Any other key accepts the match and is pushed back, so readline handles it
+            // (including the rest of escape sequences such as arrow keys)
+            char *copy = line ? strndup(line->text, line->length) : NULL;
+            if (copy != NULL) {
+                rl_replace_line(copy, 0);
+                free(copy);
+            }
+            rl_execute_next(c);
+        }
+        rl_point = rl_end;
+        break;
+    }
+
+    rl_clear_message();
+    free(matches);
+    free(original);
+    return 0;
+}
+
+// Bind Ctrl-R to the indexed history search
+void InitializeHistorySearch() {
+    rl_bind_keyseq("\\C-r", HistorySearchKey);
+}
+
+// Print welcome message with ASCII art
+void PrintWelcomeMessage() {
+    printf("\n");
+    printf(COLOR_GREEN "██████╗ ██╗    ██╗██╗███╗   ███╗███████╗██╗  ██╗\n");
+                printf("██╔══██╗██║    ██║██║████╗ ████║██╔════╝██║  ██║\n");
+                printf("██║  ██║██║ █╗ ██║██║██╔████╔██║███████╗███████║\n");
+                printf("██║  ██║██║███╗██║██║██║╚██╔╝██║╚════██║██╔══██║\n");
+                printf("██████╔╝╚███╔███╔╝██║██║ ╚═╝ ██║███████║██║  ██║\n");
+                printf("╚═════╝  ╚══╝╚══╝ ╚═╝╚═╝     ╚═╝╚══════╝╚═╝  ╚═╝\n" COLOR_RESET);
+    printf(COLOR_GREEN "Do What I Mean Shell - Linux Edition v1.0\n" COLOR_RESET);
+    printf(COLOR_GREEN "WRITTEN BY VICTOR ROMERO - 12211079\n\n" COLOR_RESET);
+    printf(COLOR_YELLOW "Type 'help' for available commands or 'exit' to quit\n" COLOR_RESET);
+    printf("\n");
+}
+
+// Print help message
+void PrintHelpMessage() {
+    printf("\n%sDWIMSH - Do What I Mean Shell%s\n\n", COLOR_BOLD, COLOR_RESET);
+    printf("Built-in commands:\n");
+    printf("  %sexit%s          - Exit the shell\n", COLOR_BOLD, COLOR_RESET);
+    printf("  %shelp%s          - Display this help message\n", COLOR_BOLD, COLOR_RESET);
+    printf("  %sclear%s         - Clear the screen\n", COLOR_BOLD, COLOR_RESET);
+    printf("  %slist%s          - List all available commands\n", COLOR_BOLD, COLOR_RESET);
+    printf("  %shistory%s       - Show command history\n", COLOR_BOLD, COLOR_RESET);
+    printf("  %shistory <text>%s - Search the whole history for lines containing text\n", COLOR_BOLD, COLOR_RESET);
+    printf("\n");
+    printf("Features:\n");
+    printf("  - Command correction using Hamming distance\n");
+    printf("  - Command correction using Levenshtein distance\n");
+    printf("  - Command correction using anagram detection\n");
+    printf("  - Command history with up/down arrow keys\n");
+    printf("  - Indexed reverse history search with Ctrl-R\n");
+    printf("  - Tab completion for commands\n");
+    printf("  - Wildcard expansion (*, ?, [...], **) and brace expansion ({a,b}, {1..5})\n");
+    printf("\n");
+}
+
+// Cleanup resources and memory
+void Cleanup() {
+    CloseHistory();
+    FreeCommandsMemory();
+    ClearDirListingCache(&globCache);
+    clear_history();
+}
+
+// Get current directory for prompt
+char *GetPrompt() {
+    char cwd[MAX_PATH_LENGTH];
+    char *prompt = malloc(MAX_PATH_LENGTH);
+    
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        strcpy(cwd, "unknown");
+    }
+    
+    // If in home directory, use '~'
+    if (strncmp(cwd, homeDir, strlen(homeDir)) == 0) {
+        char *home_relative = cwd + strlen(homeDir);
+        if (*home_relative == '\0') {
+            sprintf(prompt, COLOR_GREEN "dwimsh" COLOR_YELLOW ":" COLOR_BLUE "~" COLOR_RESET "$ ");
+        } else {
+            sprintf(prompt, COLOR_GREEN "dwimsh" COLOR_YELLOW ":" COLOR_BLUE "~%s" COLOR_RESET "$ ", home_relative);
+        }
+    } else {
+        sprintf(prompt, COLOR_GREEN "dwimsh" COLOR_YELLOW ":" COLOR_BLUE "%s" COLOR_RESET "$ ", basename(cwd));
+    }
+    
+    return prompt;
+}
+
+// Print text with a specific color
+void PrintColoredText(const char *text, const char *color) {
+    printf("%s%s%s", color, text, COLOR_RESET);
+}
+
+// Load commands from PATH directories
+void LoadCommands() {
+    char *path = getenv("PATH");
+    char *pathCopy = strdup(path);
+    char *dir = strtok(pathCopy, ":");
+    DIR *dirp;
+    struct dirent *entry;
+    
+    cmdTable.count = 0;
+    
+    while (dir != NULL && cmdTable.count < MAX_CMDS) {
+        dirp = opendir(dir);
+        if (dirp != NULL) {
+            while ((entry = readdir(dirp)) != NULL && cmdTable.count < MAX_CMDS) {
+                if (entry->d_type == DT_REG || entry->d_type == DT_LNK) {
+                    // Check if the file is executable
+                    char fullPath[MAX_PATH_LENGTH];
+                    snprintf(fullPath, MAX_PATH_LENGTH, "%s/%s", dir, entry->d_name);
+                    if (access(fullPath, X_OK) == 0) {
+                        cmdTable.commands[cmdTable.count] = strdup(entry->d_name);
+                        cmdTable.count++;
+                    }
+                }
+            }
+            closedir(dirp);
+        }
+        dir = strtok(NULL, ":");
+    }
+    
+    free(pathCopy);
+    
+    // Sort commands alphabetically for easier searching
+    for (int i = 0; i < cmdTable.count; i++) {
+        for (int j = i + 1; j < cmdTable.count; j++) {
+            if (strcmp(cmdTable.commands[i], cmdTable.commands[j]) > 0) {
+                char *temp = cmdTable.commands[i];
+                cmdTable.commands[i] = cmdTable.commands[j];
+                cmdTable.commands[j] = temp;
+            }
+        }
+    }
+    
+    // Add built-in commands
+    if (cmdTable.count < MAX_CMDS) {
+        cmdTable.commands[cmdTable.count++] = strdup("exit");
+    }
+    if (cmdTable.count < MAX_CMDS) {
+        cmdTable.commands[cmdTable.count++] = strdup("help");
+    }
+    if (cmdTable.count < MAX_CMDS) {
+        cmdTable.commands[cmdTable.count++] = strdup("clear");
+    }
+    if (cmdTable.count < MAX_CMDS) {
+        cmdTable.commands[cmdTable.count++] = strdup("list");
+    }
+    if (cmdTable.count < MAX_CMDS) {
+        cmdTable.commands[cmdTable.count++] = strdup("history");
+    }
+    
+    BuildCommandIndex();
+}
+
+// Check if a command exists in the table using binary search
+int IsCommandInTable(const char *cmd) {
+    if (cmd == NULL || *cmd == '\0')
+        return 0;
+    
+    int low = 0, high = cmdTable.count - 1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        int cmp = strcmp(cmd, cmdTable.commands[mid]);
+        if (cmp == 0)
+            return 1;
+        else if (cmp < 0)
+            high = mid - 1;
+        else
+            low = mid + 1;
+    }
+    return 0;
+}
+
+// Check if a command is a built-in command
+int IsBuiltInCommand(const char *cmd) {
+    if (cmd == NULL || *cmd == '\0')
+        return 0;
+        
+    return (strcmp(cmd, "exit") == 0 ||
+            strcmp(cmd, "help") == 0 ||
+            strcmp(cmd, "clear") == 0 ||
+            strcmp(cmd, "list") == 0 ||
+            strcmp(cmd, "history") == 0);
+}
+
+// Free the memory used in the command table
+void FreeCommandsMemory() {
+    for (int i = 0; i < cmdTable.count; i++) {
+        free(cmdTable.commands[i]);
+    }
+    FreeCommandIndex();
+}
+
+// Pack three bytes of a name into a trigram key
+uint32_t TrigramKey(const char *s) {
+    return ((uint32_t)(unsigned char)s[0] << 16) |
+           ((uint32_t)(unsigned char)s[1] << 8) |
+           (uint32_t)(unsigned char)s[2];
+}
+
+// Compare two packed (trigram, command) pairs for qsort
+int CompareTrigramPairs(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Build the trigram posting lists and name-length buckets over the command table
+void BuildCommandIndex() {
+    FreeCommandIndex();
+
+    size_t pairCount = 0;
+    for (int i = 0; i < cmdTable.count; i++) {
+        int len = strlen(cmdTable.commands[i]);
+        if (len >= TRIGRAM_SIZE)
+            pairCount += len - TRIGRAM_SIZE + 1;
+    }
+
+    // Collect every (trigram, command) pair, then sort them into CSR posting lists
+    uint64_t *pairs = malloc((pairCount + 1) * sizeof(uint64_t));
+    cmdIndex.keys = malloc((pairCount + 1) * sizeof(uint32_t));
+    cmdIndex.offsets = malloc((pairCount + 2) * sizeof(int));
+    cmdIndex.postings = malloc((pairCount + 1) * sizeof(int));
+    cmdIndex.marks = calloc(cmdTable.count + 1, sizeof(unsigned int));
+    cmdIndex.hits = calloc(cmdTable.count + 1, sizeof(int));
+    cmdIndex.lengthOrder = malloc((cmdTable.count + 1) * sizeof(int));
+
+    if (pairs == NULL || cmdIndex.keys == NULL || cmdIndex.offsets == NULL || cmdIndex.postings == NULL ||
+        cmdIndex.marks == NULL || cmdIndex.hits == NULL || cmdIndex.lengthOrder == NULL) {
+        free(pairs);
+        FreeCommandIndex();
+        return;
+    }
+
+    size_t k = 0;
+    for (int i = 0; i < cmdTable.count; i++) {
+        const char *name = cmdTable.commands[i];
+        int len = strlen(name);
+        for (int j = 0; j + TRIGRAM_SIZE <= len; j++) {
+            pairs[k++] = ((uint64_t)TrigramKey(name + j) << 32) | (uint32_t)i;
+        }
+    }
+    qsort(pairs, pairCount, sizeof(uint64_t), CompareTrigramPairs);
+
+    int postingCount = 0;
+    cmdIndex.keyCount = 0;
+    for (size_t p = 0; p < pairCount; p++) {
+        if (p > 0 && pairs[p] == pairs[p - 1])
+            continue;
+
+        uint32_t key = (uint32_t)(pairs[p] >> 32);
+        if (cmdIndex.keyCount == 0 || cmdIndex.keys[cmdIndex.keyCount - 1] != key) {
+            cmdIndex.keys[cmdIndex.keyCount] = key;
+            cmdIndex.offsets[cmdIndex.keyCount] = postingCount;
+            cmdIndex.keyCount++;
+        }
+        cmdIndex.postings[postingCount++] = (int)(pairs[p] & 0xffffffff);
+    }
+    cmdIndex.offsets[cmdIndex.keyCount] = postingCount;
+    free(pairs);
+
+    // Group commands by name length (counting sort keeps alphabetical order inside a bucket)
+    memset(cmdIndex.lengthOffsets, 0, sizeof(cmdIndex.lengthOffsets));
+    for (int i = 0; i < cmdTable.count; i++) {
+        int len = strlen(cmdTable.commands[i]);
+        if (len >= MAX_NAME_LENGTH)
+            len = MAX_NAME_LENGTH - 1;
+        cmdIndex.lengthOffsets[len + 1]++;
+    }
+    for (int len = 0; len < MAX_NAME_LENGTH; len++) {
+        cmdIndex.lengthOffsets[len + 1] += cmdIndex.lengthOffsets[len];
+    }
+
+    int fill[MAX_NAME_LENGTH];
+    memcpy(fill, cmdIndex.lengthOffsets, sizeof(fill));
+    for (int i = 0; i < cmdTable.count; i++) {
+        int len = strlen(cmdTable.commands[i]);
+        if (len >= MAX_NAME_LENGTH)
+            len = MAX_NAME_LENGTH - 1;
+        cmdIndex.lengthOrder[fill[len]++] = i;
+    }
+
+    cmdIndex.generation = 0;
+}
+
+// Free the memory used by the command index
+void FreeCommandIndex() {
+    free(cmdIndex.keys);
+    free(cmdIndex.offsets);
+    free(cmdIndex.postings);
+    free(cmdIndex.marks);
+    free(cmdIndex.hits);
+    free(cmdIndex.lengthOrder);
+    memset(&cmdIndex, 0, sizeof(cmdIndex));
+}
+
+// Look up the posting list of a trigram using binary search
+const int *FindPostingList(uint32_t key, int *size) {
+    int low = 0, high = cmdIndex.keyCount - 1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        if (cmdIndex.keys[mid] == key) {
+            *size = cmdIndex.offsets[mid + 1] - cmdIndex.offsets[mid];
+            return cmdIndex.postings + cmdIndex.offsets[mid];
+        } else if (cmdIndex.keys[mid] < key) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    *size = 0;
+    return NULL;
+}
+
+// Find commands containing every trigram of cmd by intersecting posting lists, shortest first
+int FindSubstringCandidates(const char *cmd, int *candidates) {
+    int len = strlen(cmd);
+    int listCount = len - TRIGRAM_SIZE + 1;
+    if (listCount <= 0 || listCount > MAX_CMD_LENGTH)
+        return 0;
+
+    const int *lists[listCount];
+    int sizes[listCount];
+    const int *shortestList = NULL;
+    int shortestSize = 0;
+
+    for (int i = 0; i < listCount; i++) {
+        lists[i] = FindPostingList(TrigramKey(cmd + i), &sizes[i]);
+        if (sizes[i] == 0)
+            return 0;
+        if (shortestList == NULL || sizes[i] < shortestSize) {
+            shortestList = lists[i];
+            shortestSize = sizes[i];
+        }
+    }
+
+    int count = shortestSize;
+    memcpy(candidates, shortestList, count * sizeof(int));
+
+    for (int i = 0; i < listCount && count > 0; i++) {
+        if (lists[i] == shortestList)
+            continue;
+
+        // Both lists are sorted by command index, so a linear merge is enough
+        int kept = 0, p = 0;
+        for (int c = 0; c < count; c++) {
+            while (p < sizes[i] && lists[i][p] < candidates[c])
+                p++;
+            if (p < sizes[i] && lists[i][p] == candidates[c])
+                candidates[kept++] = candidates[c];
+        }
+        count = kept;
+    }
+
+    return count;
+}
+
+// Sort overlap candidates by shared trigram count (descending), then alphabetically
+int CompareTrigramHits(const void *a, const void *b) {
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    if (cmdIndex.hits[x] != cmdIndex.hits[y])
+        return cmdIndex.hits[y] - cmdIndex.hits[x];
+    return x - y;
+}
+
+// Find commands sharing most of the trigrams of cmd, counting hits only on their posting lists
+int FindTrigramOverlapCandidates(const char *cmd, int *candidates) {
+    int len = strlen(cmd);
+    int queryCount = len - TRIGRAM_SIZE + 1;
+    if (queryCount < 2 || queryCount > MAX_CMD_LENGTH)
+        return 0;
+
+    // Deduplicate the query trigrams so repeated fragments are not counted twice
+    uint32_t keys[queryCount];
+    for (int i = 0; i < queryCount; i++) {
+        keys[i] = TrigramKey(cmd + i);
+    }
+    int uniqueCount = 0;
+    for (int i = 0; i < queryCount; i++) {
+        int seen = 0;
+        for (int j = 0; j < uniqueCount && !seen; j++) {
+            seen = (keys[j] == keys[i]);
+        }
+        if (!seen)
+            keys[uniqueCount++] = keys[i];
+    }
+
+    int minShared = (int)ceil(uniqueCount * TRIGRAM_OVERLAP_RATIO);
+    if (minShared < TRIGRAM_MIN_SHARED)
+        minShared = TRIGRAM_MIN_SHARED;
+    if (uniqueCount < minShared)
+        return 0;
+
+    int touchedCount = 0;
+    for (int i = 0; i < uniqueCount; i++) {
+        int size;
+        const int *list = FindPostingList(keys[i], &size);
+        for (int p = 0; p < size; p++) {
+            if (cmdIndex.hits[list[p]]++ == 0)
+                candidates[touchedCount++] = list[p];
+        }
+    }
+
+    qsort(candidates, touchedCount, sizeof(int), CompareTrigramHits);
+
+    // Keep the strong candidates and reset only the counters that were touched
+    int count = 0;
+    for (int i = 0; i < touchedCount; i++) {
+        int index = candidates[i];
+        if (cmdIndex.hits[index] >= minShared)
+            candidates[count++] = index;
+        else
+            cmdIndex.hits[index] = 0;
+    }
+    for (int i = 0; i < count; i++) {
+        cmdIndex.hits[candidates[i]] = 0;
+    }
+
+    return count;
+}
+
+// Split user input into tokens
+void TokenizeUserInput(char *command, char **tokens, int *tokenCount) {
+    *tokenCount = 0;
+    char *token = strtok(command, " \t");
+    
+    while (token != NULL && *tokenCount < MAX_CMD_LENGTH - 1) {
+        tokens[*tokenCount] = token;
+        (*tokenCount)++;
+        token = strtok(NULL, " \t");
+    }
+    
+    tokens[*tokenCount] = NULL;
+}
+
+// Print command tokens (useful for debugging)
+void PrintTokens(char **tokens, int tokenCount) {
+    for (int i = 0; i < tokenCount; i++) {
+        printf("Token %d: %s\n", i, tokens[i]);
+    }
+}
+
+// Allocate memory from an arena, grabbing a new chunk when the current one is full
+void *ArenaAlloc(Arena *arena, size_t size) {
+    size = (size + 7) & ~(size_t)7;
+    ArenaChunk *chunk = arena->head;
+
+    if (chunk == NULL || chunk->used + size > chunk->size) {
+        size_t chunkSize = size > GLOB_ARENA_CHUNK ? size : GLOB_ARENA_CHUNK;
+        chunk = malloc(sizeof(ArenaChunk) + chunkSize);
+        if (chunk == NULL)
+            return NULL;
+        chunk->next = arena->head;
+        chunk->used = 0;
+        chunk->size = chunkSize;
+        arena->head = chunk;
+    }
+
+    void *ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+// Copy a string of known length into the arena
+char *ArenaStrndup(Arena *arena, const char *str, size_t len) {
+    char *copy = ArenaAlloc(arena, len + 1);
+    if (copy == NULL)
+        return NULL;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+// Release every chunk owned by the arena
+void ArenaFree(Arena *arena) {
+    ArenaChunk *chunk = arena->head;
+    while (chunk != NULL) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->head = NULL;
+}
+
+// Append a word to the expanded argument vector, keeping it NULL-terminated
+void AppendGlobResult(GlobResult *result, char *word) {
+    if (word == NULL)
+        return;
+
+    if (result->count + 1 >= result->capacity) {
+        int capacity = result->capacity ? result->capacity * 2 : 64;
+        char **argv = realloc(result->argv, capacity * sizeof(char *));
+        if (argv == NULL)
+            return;
+        result->argv = argv;
+        result->capacity = capacity;
+    }
+
+    result->argv[result->count++] = word;
+    result->argv[result->count] = NULL;
+}
+
+// Free the expanded argument vector and its strings
+void FreeGlobResult(GlobResult *result) {
+    free(result->argv);
+    ArenaFree(&result->arena);
+    result->argv = NULL;
+    result->count = 0;
+    result->capacity = 0;
+}
+
+// djb2 string hash
+unsigned long HashString(const char *str) {
+    unsigned long hash = 5381;
+    while (*str) {
+        hash = hash * 33 + (unsigned char)*str++;
+    }
+    return hash;
+}
+
+// Read a whole directory with getdents64, keeping d_type so entries need no stat
+DirListing *ReadDirListing(const char *path) {
+    static uint64_t direntBuffer[GLOB_DIR_BUFFER_SIZE / sizeof(uint64_t)];
+
+    DirListing *listing = calloc(1, sizeof(DirListing));
+    if (listing == NULL)
+        return NULL;
+    listing->path = strdup(path);
+    if (listing->path == NULL) {
+        free(listing);
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return listing;
+
+    long nread = 0;
+    int failed = 0;
+    while (!failed && (nread = syscall(SYS_getdents64, fd, direntBuffer, sizeof(direntBuffer))) > 0) {
+        char *buffer = (char *)direntBuffer;
+
+        for (long offset = 0; offset < nread; ) {
+            struct LinuxDirent64 *dirent = (struct LinuxDirent64 *)(buffer + offset);
+            offset += dirent->d_reclen;
+
+            size_t nameLen = strlen(dirent->d_name);
+
+            // Grow the name buffer and entry array geometrically
+            if (listing->namesSize + nameLen + 1 > listing->namesCapacity) {
+                size_t capacity = listing->namesCapacity ? listing->namesCapacity * 2 : 4096;
+                while (capacity < listing->namesSize + nameLen + 1)
+                    capacity *= 2;
+                char *names = realloc(listing->names, capacity);
+                if (names == NULL) {
+                    failed = 1;
+                    break;
+                }
+                listing->names = names;
+                listing->namesCapacity = capacity;
+            }
+            if (listing->count == listing->capacity) {
+                int capacity = listing->capacity ? listing->capacity * 2 : 128;
+                DirEntryRef *entries = realloc(listing->entries, capacity * sizeof(DirEntryRef));
+                if (entries == NULL) {
+                    failed = 1;
+                    break;
+                }
+                listing->entries = entries;
+                listing->capacity = capacity;
+            }
+
+            memcpy(listing->names + listing->namesSize, dirent->d_name, nameLen + 1);
+            listing->entries[listing->count].offset = listing->namesSize;
+            listing->entries[listing->count].length = nameLen;
+            listing->entries[listing->count].type = dirent->d_type;
+            listing->count++;
+            listing->namesSize += nameLen + 1;
+        }
+    }
+
+    close(fd);
+
+    // A partial listing would silently drop matches, so only a complete read is used
+    listing->valid = !failed && nread == 0;
+    return listing;
+}
+
+// Free a directory listing
+void FreeDirListing(DirListing *listing) {
+    if (listing == NULL)
+        return;
+    free(listing->path);
+    free(listing->names);
+    free(listing->entries);
+    free(listing);
+}
+
+// Get the listing of a directory, reading it only once per input line
+DirListing *AcquireDirListing(DirListingCache *cache, const char *path) {
+    unsigned long hash = HashString(path);
+
+    for (int i = 0; i < cache->count; i++) {
+        DirListing *listing = cache->listings[i];
+        if (listing->hash == hash && strcmp(listing->path, path) == 0)
+            return listing->valid ? listing : NULL;
+    }
+
+    DirListing *listing = ReadDirListing(path);
+    if (listing == NULL)
+        return NULL;
+    listing->hash = hash;
+
+    // Once the cache is full, listings are handed out uncached and freed on release
+    if (cache->count < GLOB_CACHE_SIZE) {
+        listing->cached = 1;
+        cache->listings[cache->count++] = listing;
+    }
+
+    if (!listing->valid) {
+        ReleaseDirListing(listing);
+        return NULL;
+    }
+    return listing;
+}
+
+// Release a listing obtained from AcquireDirListing
+void ReleaseDirListing(DirListing *listing) {
+    if (listing != NULL && !listing->cached)
+        FreeDirListing(listing);
+}
+
+// Drop all cached listings (called after every input line)
+void ClearDirListingCache(DirListingCache *cache) {
+    for (int i = 0; i < cache->count; i++) {
+        FreeDirListing(cache->listings[i]);
+    }
+    cache->count = 0;
+}
+
+// Check whether a directory entry is a directory, falling back to stat only when d_type is not enough
+int IsDirectoryEntry(const char *path, unsigned char type, int followLinks) {
+    if (type == DT_DIR)
+        return 1;
+    if (type != DT_UNKNOWN && !(type == DT_LNK && followLinks))
+        return 0;
+
+    struct stat st;
+    int rc = followLinks ? stat(path, &st) : lstat(path, &st);
+    return rc == 0 && S_ISDIR(st.st_mode);
+}
+
+// Parse a [...] bracket expression into a 256-bit bitmap, returning the index of ']' or -1
+int ParseGlobClass(const char *s, int start, int len, unsigned char *bitmap) {
+    int i = start + 1;
+    int negate = 0;
+    int first = 1;
+
+    memset(bitmap, 0, 32);
+
+    if (i < len && (s[i] == '!' || s[i] == '^')) {
+        negate = 1;
+        i++;
+    }
+
+    while (i < len && (s[i] != ']' || first)) {
+        first = 0;
+        unsigned char lo = s[i];
+        if (lo == '\\' && i + 1 < len)
+            lo = s[++i];
+
+        if (i + 2 < len && s[i + 1] == '-' && s[i + 2] != ']') {
+            unsigned char hi = s[i + 2];
+            for (int c = lo; c <= hi; c++) {
+                bitmap[c >> 3] |= 1 << (c & 7);
+            }
+            i += 3;
+        } else {
+            bitmap[lo >> 3] |= 1 << (lo & 7);
+            i++;
+        }
+    }
+
+    if (i >= len)
+        return -1;
+
+    if (negate) {
+        for (int b = 0; b < 32; b++) {
+            bitmap[b] = ~bitmap[b];
+        }
+    }
+    return i;
+}
+
+// Compile one path segment of a glob pattern into a list of match operations; returns 0 if out of memory
+int CompileGlobSegment(const char *s, int len, GlobSegment *seg, Arena *arena) {
+    int classCount = 0;
+    for (int i = 0; i < len; i++) {
+        if (s[i] == '[')
+            classCount++;
+    }
+
+    seg->ops = ArenaAlloc(arena, (len + 1) * sizeof(GlobOp));
+    seg->classes = classCount ? ArenaAlloc(arena, classCount * 32) : NULL;
+    seg->literal = ArenaAlloc(arena, len + 1);
+    if (seg->ops == NULL || (classCount && seg->classes == NULL) || seg->literal == NULL)
+        return 0;
+    seg->opCount = 0;
+    seg->hasMeta = 0;
+    seg->isGlobStar = (len == 2 && s[0] == '*' && s[1] == '*');
+    seg->matchesDot = (len > 0 && s[0] == '.');
+
+    int literalLen = 0;
+    int classIndex = 0;
+
+    for (int i = 0; i < len; i++) {
+        GlobOp *op = &seg->ops[seg->opCount];
+
+        if (s[i] == '\\' && i + 1 < len) {
+            i++;
+            op->type = GLOB_OP_CHAR;
+            op->ch = s[i];
+            seg->literal[literalLen++] = s[i];
+        } else if (s[i] == '*') {
+            seg->hasMeta = 1;
+            // Consecutive stars are equivalent to a single one
+            if (seg->opCount > 0 && seg->ops[seg->opCount - 1].type == GLOB_OP_STAR)
+                continue;
+            op->type = GLOB_OP_STAR;
+        } else if (s[i] == '?') {
+            seg->hasMeta = 1;
+            op->type = GLOB_OP_ANY;
+        } else if (s[i] == '[' && classIndex < classCount) {
+            int close = ParseGlobClass(s, i, len, seg->classes[classIndex]);
+            if (close < 0) {
+                op->type = GLOB_OP_CHAR;
+                op->ch = '[';
+                seg->literal[literalLen++] = '[';
+            } else {
+                seg->hasMeta = 1;
+                op->type = GLOB_OP_CLASS;
+                op->classIndex = classIndex++;
+                i = close;
+            }
+        } else {
+            op->type = GLOB_OP_CHAR;
+            op->ch = s[i];
+            seg->literal[literalLen++] = s[i];
+        }
+        seg->opCount++;
+    }
+
+    seg->literal[literalLen] = '\0';
+    return 1;
+}
+
+// Split a pattern on '/' and compile every segment; returns 0 if it has too many segments or memory runs out
+int CompileGlobPattern(const char *pattern, GlobPattern *out, Arena *arena) {
+    int len = strlen(pattern);
+
+    out->segmentCount = 0;
+    out->absolute = (len > 0 && pattern[0] == '/');
+    out->trailingSlash = (len > 1 && pattern[len - 1] == '/');
+
+    int start = 0;
+    while (start < len) {
+        int end = start;
+        while (end < len && pattern[end] != '/')
+            end++;
+
+        // Skip empty segments produced by leading or repeated slashes
+        if (end > start) {
+            if (out->segmentCount == MAX_GLOB_SEGMENTS)
+                return 0;
+            if (!CompileGlobSegment(pattern + start, end - start, &out->segments[out->segmentCount++], arena))
+                return 0;
+        }
+        start = end + 1;
+    }
+
+    return out->segmentCount > 0;
+}
+
+// Match a file name against a compiled segment (iterative, backtracks only to the last star)
+int GlobMatchSegment(const GlobSegment *seg, const char *name, int len) {
+    int p = 0, n = 0;
+    int starP = -1, starN = 0;
+
+    while (n < len) {
+        if (p < seg->opCount) {
+            const GlobOp *op = &seg->ops[p];
+            unsigned char c = name[n];
+
+            if (op->type == GLOB_OP_STAR) {
+                starP = p++;
+                starN = n;
+                continue;
+            }
+            if (op->type == GLOB_OP_ANY ||
+                (op->type == GLOB_OP_CHAR && op->ch == c) ||
+                (op->type == GLOB_OP_CLASS && (seg->classes[op->classIndex][c >> 3] & (1 << (c & 7))))) {
+                p++;
+                n++;
+                continue;
+            }
+        }
+
+        if (starP < 0)
+            return 0;
+        p = starP + 1;
+        n = ++starN;
+    }
+
+    while (p < seg->opCount && seg->ops[p].type == GLOB_OP_STAR)
+        p++;
+    return p == seg->opCount;
+}
+
+// Check if a word contains an unescaped glob metacharacter
+int HasGlobMeta(const char *word) {
+    for (const char *c = word; *c; c++) {
+        if (*c == '\\' && c[1] != '\0') {
+            c++;
+        } else if (*c == '*' || *c == '?' || *c == '[') {
+            return 1;
+        }
+    }
+    return 0;
 }
 
-// Cleanup resources and memory
-void Cleanup() {
-    SaveHistory();
-    FreeCommandsMemory();
-    clear_history();
+// Record a path produced by the glob walk
+void AddGlobMatch(GlobContext *ctx, const char *path, size_t pathLen) {
+    GlobResult *result = ctx->result;
+    char *match = ArenaAlloc(&result->arena, pathLen + 2);
+    if (match == NULL)
+        return;
+
+    memcpy(match, path, pathLen);
+    if (ctx->pattern->trailingSlash)
+        match[pathLen++] = '/';
+    match[pathLen] = '\0';
+
+    AppendGlobResult(result, match);
 }
 
-// Get current directory for prompt
-char *GetPrompt() {
-    char cwd[MAX_PATH_LENGTH];
-    char *prompt = malloc(MAX_PATH_LENGTH);
-    
-    if (getcwd(cwd, sizeof(cwd)) == NULL) {
-        strcpy(cwd, "unknown");
-    }
-    
-    // If in home directory, use '~'
-    if (strncmp(cwd, homeDir, strlen(homeDir)) == 0) {
-        char *home_relative = cwd + strlen(homeDir);
-        if (*home_relative == '\0') {
-            sprintf(prompt, COLOR_GREEN "dwimsh" COLOR_YELLOW ":" COLOR_BLUE "~" COLOR_RESET "$ ");
+// Recursively match pattern segments starting at segIndex below the directory in path
+void GlobWalk(GlobContext *ctx, int segIndex, char *path, size_t pathLen) {
+    GlobPattern *pattern = ctx->pattern;
+    GlobSegment *seg = &pattern->segments[segIndex];
+    int isLast = (segIndex == pattern->segmentCount - 1);
+
+    // Literal segments need no directory listing
+    if (!seg->hasMeta) {
+        size_t literalLen = strlen(seg->literal);
+        if (pathLen + literalLen + 2 >= GLOB_PATH_MAX)
+            return;
+
+        memcpy(path + pathLen, seg->literal, literalLen + 1);
+        size_t newLen = pathLen + literalLen;
+
+        if (isLast) {
+            struct stat st;
+            if (pattern->trailingSlash ? (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) : (lstat(path, &st) == 0))
+                AddGlobMatch(ctx, path, newLen);
         } else {
-            sprintf(prompt, COLOR_GREEN "dwimsh" COLOR_YELLOW ":" COLOR_BLUE "~%s" COLOR_RESET "$ ", home_relative);
+            path[newLen++] = '/';
+            path[newLen] = '\0';
+            GlobWalk(ctx, segIndex + 1, path, newLen);
         }
-    } else {
-        sprintf(prompt, COLOR_GREEN "dwimsh" COLOR_YELLOW ":" COLOR_BLUE "%s" COLOR_RESET "$ ", basename(cwd));
+        path[pathLen] = '\0';
+        return;
     }
-    
-    return prompt;
-}
 
-// Print text with a specific color
-void PrintColoredText(const char *text, const char *color) {
-    printf("%s%s%s", color, text, COLOR_RESET);
-}
+    // '**' as a whole segment matches zero or more directories
+    if (seg->isGlobStar && !isLast)
+        GlobWalk(ctx, segIndex + 1, path, pathLen);
 
-// Load commands from PATH directories
-void LoadCommands() {
-    char *path = getenv("PATH");
-    char *pathCopy = strdup(path);
-    char *dir = strtok(pathCopy, ":");
-    DIR *dirp;
-    struct dirent *entry;
-    
-    cmdTable.count = 0;
-    
-    while (dir != NULL && cmdTable.count < MAX_CMDS) {
-        dirp = opendir(dir);
-        if (dirp != NULL) {
-            while ((entry = readdir(dirp)) != NULL && cmdTable.count < MAX_CMDS) {
-                if (entry->d_type == DT_REG || entry->d_type == DT_LNK) {
-                    // Check if the file is executable
-                    char fullPath[MAX_PATH_LENGTH];
-                    snprintf(fullPath, MAX_PATH_LENGTH, "%s/%s", dir, entry->d_name);
-                    if (access(fullPath, X_OK) == 0) {
-                        cmdTable.commands[cmdTable.count] = strdup(entry->d_name);
-                        cmdTable.count++;
-                    }
-                }
+    DirListing *listing = AcquireDirListing(ctx->cache, pathLen > 0 ? path : ".");
+    if (listing == NULL)
+        return;
+
+    for (int i = 0; i < listing->count; i++) {
+        const DirEntryRef *entry = &listing->entries[i];
+        const char *name = listing->names + entry->offset;
+        int nameLen = entry->length;
+
+        // Hidden files only match patterns that start with '.'; '.' and '..' never match
+        if (name[0] == '.' && (!seg->matchesDot || seg->isGlobStar || nameLen == 1 || (nameLen == 2 && name[1] == '.')))
+            continue;
+        if (!seg->isGlobStar && !GlobMatchSegment(seg, name, nameLen))
+            continue;
+        if (pathLen + nameLen + 2 >= GLOB_PATH_MAX)
+            continue;
+
+        memcpy(path + pathLen, name, nameLen + 1);
+        size_t newLen = pathLen + nameLen;
+
+        if (isLast) {
+            if (!pattern->trailingSlash || IsDirectoryEntry(path, entry->type, 1))
+                AddGlobMatch(ctx, path, newLen);
+        }
+
+        if (seg->isGlobStar) {
+            // Descend without following symlinks, staying on the same '**' segment
+            if (IsDirectoryEntry(path, entry->type, 0)) {
+                path[newLen++] = '/';
+                path[newLen] = '\0';
+                GlobWalk(ctx, segIndex, path, newLen);
             }
-            closedir(dirp);
+        } else if (!isLast && IsDirectoryEntry(path, entry->type, 1)) {
+            path[newLen++] = '/';
+            path[newLen] = '\0';
+            GlobWalk(ctx, segIndex + 1, path, newLen);
         }
-        dir = strtok(NULL, ":");
     }
-    
-    free(pathCopy);
-    
-    // Sort commands alphabetically for easier searching
-    for (int i = 0; i < cmdTable.count; i++) {
-        for (int j = i + 1; j < cmdTable.count; j++) {
-            if (strcmp(cmdTable.commands[i], cmdTable.commands[j]) > 0) {
-                char *temp = cmdTable.commands[i];
-                cmdTable.commands[i] = cmdTable.commands[j];
-                cmdTable.commands[j] = temp;
+
+    path[pathLen] = '\0';
+    ReleaseDirListing(listing);
+}
+
+// Compare two strings for qsort
+int CompareStrings(const void *a, const void *b) {
+    return strcmp(*(const char **)a, *(const char **)b);
+}
+
+// Expand glob characters in a single word; words without matches are kept as typed
+void ExpandGlobWord(GlobContext *ctx, const char *word) {
+    GlobResult *result = ctx->result;
+
+    if (HasGlobMeta(word)) {
+        GlobPattern pattern;
+        if (CompileGlobPattern(word, &pattern, &result->arena)) {
+            char path[GLOB_PATH_MAX];
+            int before = result->count;
+
+            path[0] = '\0';
+            if (pattern.absolute)
+                strcpy(path, "/");
+
+            ctx->pattern = &pattern;
+            GlobWalk(ctx, 0, path, strlen(path));
+            ctx->pattern = NULL;
+
+            if (result->count > before) {
+                qsort(result->argv + before, result->count - before, sizeof(char *), CompareStrings);
+                return;
             }
         }
     }
-    
-    // Add built-in commands
-    if (cmdTable.count < MAX_CMDS) {
-        cmdTable.commands[cmdTable.count++] = strdup("exit");
-    }
-    if (cmdTable.count < MAX_CMDS) {
-        cmdTable.commands[cmdTable.count++] = strdup("help");
-    }
-    if (cmdTable.count < MAX_CMDS) {
-        cmdTable.commands[cmdTable.count++] = strdup("clear");
-    }
-    if (cmdTable.count < MAX_CMDS) {
-        cmdTable.commands[cmdTable.count++] = strdup("list");
-    }
-    if (cmdTable.count < MAX_CMDS) {
-        cmdTable.commands[cmdTable.count++] = strdup("history");
+
+    // Remove backslashes that escape glob or brace characters
+    int len = strlen(word);
+    char *copy = ArenaAlloc(&result->arena, len + 1);
+    if (copy == NULL)
+        return;
+
+    int j = 0;
+    for (int i = 0; i < len; i++) {
+        if (word[i] == '\\' && i + 1 < len && strchr("*?[]{},\\", word[i + 1]) != NULL)
+            i++;
+        copy[j++] = word[i];
     }
+    copy[j] = '\0';
+
+    AppendGlobResult(result, copy);
 }
 
-// Check if a command exists in the table using binary search
-int IsCommandInTable(const char *cmd) {
-    if (cmd == NULL || *cmd == '\0')
-        return 0;
-    
-    int low = 0, high = cmdTable.count - 1;
-    while (low <= high) {
-        int mid = (low + high) / 2;
-        int cmp = strcmp(cmd, cmdTable.commands[mid]);
-        if (cmp == 0)
-            return 1;
-        else if (cmp < 0)
-            high = mid - 1;
-        else
-            low = mid + 1;
+// Expand {a,b,c} alternatives and {x..y} ranges, then glob each resulting word
+void ExpandBraces(GlobContext *ctx, const char *word) {
+    int len = strlen(word);
+
+    if (ctx->overflow)
+        return;
+    if (ctx->expansionCount >= MAX_BRACE_EXPANSIONS) {
+        ctx->overflow = 1;
+        return;
     }
-    return 0;
-}
 
-// Check if a command is a built-in command
-int IsBuiltInCommand(const char *cmd) {
-    if (cmd == NULL || *cmd == '\0')
-        return 0;
-        
-    return (strcmp(cmd, "exit") == 0 ||
-            strcmp(cmd, "help") == 0 ||
-            strcmp(cmd, "clear") == 0 ||
-            strcmp(cmd, "list") == 0 ||
-            strcmp(cmd, "history") == 0);
-}
+    for (int open = 0; open < len; open++) {
+        if (word[open] == '\\') {
+            open++;
+            continue;
+        }
+        if (word[open] != '{')
+            continue;
 
-// Free the memory used in the command table
-void FreeCommandsMemory() {
-    for (int i = 0; i < cmdTable.count; i++) {
-        free(cmdTable.commands[i]);
+        // Find the matching close brace and count top-level commas
+        int depth = 0, commas = 0, close = -1;
+        for (int i = open + 1; i < len && close < 0; i++) {
+            if (word[i] == '\\') {
+                i++;
+            } else if (word[i] == '{') {
+                depth++;
+            } else if (word[i] == '}') {
+                if (depth == 0)
+                    close = i;
+                else
+                    depth--;
+            } else if (word[i] == ',' && depth == 0) {
+                commas++;
+            }
+        }
+        if (close < 0)
+            continue;
+
+        char buffer[len + 32];
+        const char *suffix = word + close + 1;
+        memcpy(buffer, word, open);
+
+        if (commas > 0) {
+            int altStart = open + 1;
+            depth = 0;
+            for (int i = open + 1; i <= close; i++) {
+                if (word[i] == '\\') {
+                    i++;
+                    continue;
+                }
+                if (word[i] == '{') {
+                    depth++;
+                } else if (word[i] == '}' && i != close) {
+                    depth--;
+                } else if ((word[i] == ',' && depth == 0) || i == close) {
+                    int altLen = i - altStart;
+                    memcpy(buffer + open, word + altStart, altLen);
+                    strcpy(buffer + open + altLen, suffix);
+                    ExpandBraces(ctx, buffer);
+                    altStart = i + 1;
+                }
+            }
+            return;
+        }
+
+        // Sequence expression: {1..10} or {a..z}
+        char body[len + 1];
+        memcpy(body, word + open + 1, close - open - 1);
+        body[close - open - 1] = '\0';
+
+        char *dots = strstr(body, "..");
+        if (dots != NULL) {
+            *dots = '\0';
+            const char *from = body, *to = dots + 2;
+            char *endFrom, *endTo;
+            long first = strtol(from, &endFrom, 10);
+            long last = strtol(to, &endTo, 10);
+            int numeric = (*from && *to && *endFrom == '\0' && *endTo == '\0');
+            int alpha = (strlen(from) == 1 && strlen(to) == 1 && isalpha((unsigned char)*from) && isalpha((unsigned char)*to));
+
+            if (alpha) {
+                first = (unsigned char)*from;
+                last = (unsigned char)*to;
+            }
+            if (numeric || alpha) {
+                long step = first <= last ? 1 : -1;
+                for (long v = first; !ctx->overflow; v += step) {
+                    int n = alpha ? snprintf(buffer + open, 2, "%c", (int)v) : snprintf(buffer + open, 24, "%ld", v);
+                    strcpy(buffer + open + n, suffix);
+                    ExpandBraces(ctx, buffer);
+                    if (v == last)
+                        break;
+                }
+                return;
+            }
+        }
     }
+
+    ctx->expansionCount++;
+    ExpandGlobWord(ctx, word);
 }
 
-// Split user input into tokens
-void TokenizeUserInput(char *command, char **tokens, int *tokenCount) {
-    *tokenCount = 0;
-    char *token = strtok(command, " \t");
-    
-    while (token != NULL && *tokenCount < MAX_CMD_LENGTH - 1) {
-        tokens[*tokenCount] = token;
-        (*tokenCount)++;
-        token = strtok(NULL, " \t");
+// Expand braces and wildcards in every token into a new argument vector
+// Returns -1 if a token expands to more than MAX_BRACE_EXPANSIONS words
+int ExpandTokens(char **tokens, int tokenCount, GlobResult *result) {
+    GlobContext ctx = { result, &globCache, NULL, 0, 0 };
+
+    // The history builtin takes a literal search pattern, so its words are kept as typed
+    if (tokenCount > 0 && strcmp(tokens[0], "history") == 0) {
+        for (int i = 0; i < tokenCount; i++) {
+            AppendGlobResult(result, ArenaStrndup(&result->arena, tokens[i], strlen(tokens[i])));
+        }
+        return 0;
     }
-    
-    tokens[*tokenCount] = NULL;
-}
 
-// Print command tokens (useful for debugging)
-void PrintTokens(char **tokens, int tokenCount) {
     for (int i = 0; i < tokenCount; i++) {
-        printf("Token %d: %s\n", i, tokens[i]);
+        ctx.expansionCount = 0;
+        ExpandBraces(&ctx, tokens[i]);
+        if (ctx.overflow)
+            return -1;
     }
+    return 0;
 }
 
 // Calculate the Hamming distance between two strings
@@ -356,57 +2298,170 @@ int AreAnagrams(const char *str1, const char *str2) {
     return 1;
 }
 
+// Check if two names are close enough in length to be worth comparing
+int IsLengthSimilar(int len_cmd, int len_table) {
+    return fabs(len_cmd - len_table) <= fmax(len_cmd, len_table) * LEVENSHTEIN_THRESHOLD;
+}
+
+// Lower bound on the Hamming and Levenshtein distances, from the character counts of both names
+int BagDistance(int *queryCounts, int len_cmd, const char *name, int len_table) {
+    unsigned char used[MAX_NAME_LENGTH];
+    int common = 0;
+    
+    for (int i = 0; i < len_table && common < MAX_NAME_LENGTH; i++) {
+        unsigned char c = name[i];
+        if (queryCounts[c] > 0) {
+            queryCounts[c]--;
+            used[common++] = c;
+        }
+    }
+    
+    // Restore the query counts for the next name
+    for (int i = 0; i < common; i++) {
+        queryCounts[used[i]]++;
+    }
+    
+    return len_cmd - common > len_table - common ? len_cmd - common : len_table - common;
+}
+
+// Fewest edits needed to turn pattern into some substring of text
+int SubstringEditDistance(const char *pattern, const char *text) {
+    int len1 = strlen(pattern);
+    int len2 = strlen(text);
+    int row[len2 + 1];
+    
+    // A match may start anywhere in text, so the first row costs nothing
+    for (int j = 0; j <= len2; j++)
+        row[j] = 0;
+    
+    for (int i = 1; i <= len1; i++) {
+        int diagonal = row[0];
+        row[0] = i;
+        for (int j = 1; j <= len2; j++) {
+            int above = row[j];
+            int cost = (pattern[i-1] == text[j-1]) ? 0 : 1;
+            
+            int min = above + 1;
+            if (row[j-1] + 1 < min) min = row[j-1] + 1;
+            if (diagonal + cost < min) min = diagonal + cost;
+            
+            row[j] = min;
+            diagonal = above;
+        }
+    }
+    
+    int best = len1;
+    for (int j = 0; j <= len2; j++) {
+        if (row[j] < best)
+            best = row[j];
+    }
+    return best;
+}
+
+// Add a command to the recommendations unless it was already suggested for this query
+void AddRecommendation(int index, char **recommendations, int *recommendationCount) {
+    if (cmdIndex.marks[index] == cmdIndex.generation || *recommendationCount >= MAX_RECOMMENDATIONS)
+        return;
+    cmdIndex.marks[index] = cmdIndex.generation;
+    recommendations[*recommendationCount] = strdup(cmdTable.commands[index]);
+    (*recommendationCount)++;
+}
+
 // Find similar commands using multiple algorithms
 void FindSimilarCommands(const char *cmd, char **recommendations, int *recommendationCount) {
     *recommendationCount = 0;
     int len_cmd = strlen(cmd);
     
-    if (len_cmd == 0)
+    if (len_cmd == 0 || cmdIndex.marks == NULL)
         return;
     
-    for (int i = 0; i < cmdTable.count && *recommendationCount < MAX_RECOMMENDATIONS; i++) {
-        int len_table = strlen(cmdTable.commands[i]);
-        
-        // Skip very short commands
-        if (len_table < 2)
-            continue;
-        
-        // Filter: skip if the difference in length is too large
-        if (fabs(len_cmd - len_table) > fmax(len_cmd, len_table) * LEVENSHTEIN_THRESHOLD)
-            continue;
-        
-        // 1. Substring check (fast method)
-        if (strstr(cmdTable.commands[i], cmd) != NULL) {
-            recommendations[*recommendationCount] = strdup(cmdTable.commands[i]);
-            (*recommendationCount)++;
-            continue;
-        }
-        
-        // 2. Hamming distance (if lengths are equal)
-        if (len_cmd == len_table) {
-            int distance = HammingDistance(cmd, cmdTable.commands[i]);
-            if (distance >= 0 && distance <= len_cmd * 0.5) {
-                recommendations[*recommendationCount] = strdup(cmdTable.commands[i]);
-                (*recommendationCount)++;
+    // Start a new query generation so marks from previous queries are ignored
+    if (++cmdIndex.generation == 0) {
+        memset(cmdIndex.marks, 0, cmdTable.count * sizeof(unsigned int));
+        cmdIndex.generation = 1;
+    }
+    
+    int candidates[MAX_CMDS];
+    int candidateCount;
+    
+    // 1. Substring check: intersect the posting lists of every trigram of cmd
+    candidateCount = FindSubstringCandidates(cmd, candidates);
+    for (int c = 0; c < candidateCount; c++) {
+        const char *name = cmdTable.commands[candidates[c]];
+        int len_table = strlen(name);
+        if (len_table >= 2 && IsLengthSimilar(len_cmd, len_table) && strstr(name, cmd) != NULL)
+            AddRecommendation(candidates[c], recommendations, recommendationCount);
+    }
+    
+    int queryCounts[256] = {0};
+    for (int i = 0; i < len_cmd; i++) {
+        queryCounts[(unsigned char)cmd[i]]++;
+    }
+    
+    // Remaining checks only visit the length buckets that pass the length filter, closest lengths first
+    for (int delta = 0; delta < MAX_NAME_LENGTH && *recommendationCount < MAX_RECOMMENDATIONS; delta++) {
+        for (int side = 0; side < 2; side++) {
+            int len_table = side == 0 ? len_cmd - delta : len_cmd + delta;
+            
+            // Skip very short commands and lengths that are too different
+            if ((side == 1 && delta == 0) || len_table < 2 || len_table >= MAX_NAME_LENGTH)
                 continue;
+            if (!IsLengthSimilar(len_cmd, len_table))
+                continue;
+            
+            for (int b = cmdIndex.lengthOffsets[len_table]; b < cmdIndex.lengthOffsets[len_table + 1]; b++) {
+                int i = cmdIndex.lengthOrder[b];
+                if (cmdIndex.marks[i] == cmdIndex.generation)
+                    continue;
+                
+                // 2. Substring check for fragments too short to have trigrams
+                if (len_cmd < TRIGRAM_SIZE && strstr(cmdTable.commands[i], cmd) != NULL) {
+                    AddRecommendation(i, recommendations, recommendationCount);
+                    continue;
+                }
+                
+                // Skip names whose characters differ too much for any distance check below to pass
+                double allowed = fmax(len_cmd, len_table) * LEVENSHTEIN_THRESHOLD;
+                if (len_cmd == len_table && len_cmd * 0.5 > allowed)
+                    allowed = len_cmd * 0.5;
+                if (BagDistance(queryCounts, len_cmd, cmdTable.commands[i], len_table) > allowed)
+                    continue;
+                
+                // 3. Hamming distance (if lengths are equal)
+                if (len_cmd == len_table) {
+                    int distance = HammingDistance(cmd, cmdTable.commands[i]);
+                    if (distance >= 0 && distance <= len_cmd * 0.5) {
+                        AddRecommendation(i, recommendations, recommendationCount);
+                        continue;
+                    }
+                }
+                
+                // 4. Levenshtein distance (for different lengths)
+                int distance = LevenshteinDistance(cmd, cmdTable.commands[i]);
+                float normalized_distance = (float)distance / (float)fmax(len_cmd, len_table);
+                if (normalized_distance <= LEVENSHTEIN_THRESHOLD) {
+                    AddRecommendation(i, recommendations, recommendationCount);
+                    continue;
+                }
+                
+                // 5. Check if they are anagrams
+                if (AreAnagrams(cmd, cmdTable.commands[i])) {
+                    AddRecommendation(i, recommendations, recommendationCount);
+                    continue;
+                }
             }
         }
-        
-        // 3. Levenshtein distance (for different lengths)
-        int distance = LevenshteinDistance(cmd, cmdTable.commands[i]);
-        float normalized_distance = (float)distance / (float)fmax(len_cmd, len_table);
-        if (normalized_distance <= LEVENSHTEIN_THRESHOLD) {
-            recommendations[*recommendationCount] = strdup(cmdTable.commands[i]);
-            (*recommendationCount)++;
-            continue;
-        }
-        
-        // 4. Check if they are anagrams
-        if (AreAnagrams(cmd, cmdTable.commands[i])) {
-            recommendations[*recommendationCount] = strdup(cmdTable.commands[i]);
-            (*recommendationCount)++;
-            continue;
-        }
+    }
+    
+    // 6. Names sharing most trigrams of cmd, ranked after the distance matches: only kept
+    //    when cmd is within OVERLAP_MAX_EDITS of part of the name (a typo in a partial name)
+    candidateCount = FindTrigramOverlapCandidates(cmd, candidates);
+    for (int c = 0; c < candidateCount && *recommendationCount < MAX_RECOMMENDATIONS; c++) {
+        const char *name = cmdTable.commands[candidates[c]];
+        int len_table = strlen(name);
+        if (len_table >= 2 && IsLengthSimilar(len_cmd, len_table) &&
+            SubstringEditDistance(cmd, name) <= OVERLAP_MAX_EDITS)
+            AddRecommendation(candidates[c], recommendations, recommendationCount);
     }
 }
 
@@ -552,12 +2607,13 @@ int ExecuteCommand(char **tokens, int tokenCount) {
         ListCommandsTable();
         return 0;
     } else if (strcmp(tokens[0], "history") == 0) {
-        HIST_ENTRY **hist_list = history_list();
-        if (hist_list) {
-            for (int i = 0; hist_list[i]; i++) {
-                printf("%5d  %s\n", i + history_base, hist_list[i]->line);
-            }
+        char pattern[MAX_CMD_LENGTH] = "";
+        for (int i = 1; i < tokenCount; i++) {
+            if (i > 1)
+                strncat(pattern, " ", sizeof(pattern) - strlen(pattern) - 1);
+            strncat(pattern, tokens[i], sizeof(pattern) - strlen(pattern) - 1);
         }
+        PrintHistory(pattern);
         return 0;
     }
     
@@ -584,9 +2640,13 @@ int ExecuteCommand(char **tokens, int tokenCount) {
 }
 
 int main(int argc, char *argv[]) {
-    // Set up signal handlers
+    // Set up signal handlers; SIGTERM is not restarted so blocking reads notice it
+    struct sigaction termAction = {0};
+    termAction.sa_handler = HandleSignal;
+    sigemptyset(&termAction.sa_mask);
     signal(SIGINT, HandleSignal);
-    signal(SIGTERM, HandleSignal);
+    sigaction(SIGTERM, &termAction, NULL);
+    rl_signal_event_hook = CheckTerminateRequest;
     
     // Initialize history
     InitHistory();
@@ -596,6 +2656,7 @@ int main(int argc, char *argv[]) {
     
     // Set up readline tab completion
     InitializeCompletion();
+    InitializeHistorySearch();
     
     // Print welcome message
     PrintWelcomeMessage();
@@ -603,12 +2664,17 @@ int main(int argc, char *argv[]) {
     char *input;
     int should_exit = 0;
     
-    while (!should_exit) {
+    while (!should_exit && !terminateRequested) {
         // Get command using readline
         char *prompt = GetPrompt();
         input = readline(prompt);
         free(prompt);
         
+        if (terminateRequested) {
+            free(input);
+            break;
+        }
+        
         // Handle EOF (Ctrl+D)
         if (input == NULL) {
             printf("\n");
@@ -622,7 +2688,7 @@ int main(int argc, char *argv[]) {
         }
         
         // Add to history if non-empty
-        add_history(input);
+        AddHistoryLine(input);
         
         // Parse the command
         char *tokens[MAX_CMD_LENGTH];
@@ -631,20 +2697,25 @@ int main(int argc, char *argv[]) {
         char *inputCopy = strdup(input);
         TokenizeUserInput(inputCopy, tokens, &tokenCount);
         
-        if (tokenCount > 0) {
-            int result = ExecuteCommand(tokens, tokenCount);
+        // Expand wildcards and braces into the argument vector actually executed
+        GlobResult expanded = {0};
+        
+        if (ExpandTokens(tokens, tokenCount, &expanded) < 0) {
+            printf(COLOR_RED "Brace expansion produces more than %d words\n" COLOR_RESET, MAX_BRACE_EXPANSIONS);
+        } else if (expanded.count > 0) {
+            int result = ExecuteCommand(expanded.argv, expanded.count);
             
             if (result == 1) {
                 // Exit command
                 should_exit = 1;
             } else if (result == -1) {
-                // Command not found, search for recommendations
-                printf(COLOR_RED "Command not found: %s\n" COLOR_RESET, tokens[0]);
+                // Command not found, search for recommendations for the word that was looked up
+                printf(COLOR_RED "Command not found: %s\n" COLOR_RESET, expanded.argv[0]);
                 
                 char *recommendations[MAX_RECOMMENDATIONS];
                 int recommendationCount = 0;
                 
-                FindSimilarCommands(tokens[0], recommendations, &recommendationCount);
+                FindSimilarCommands(expanded.argv[0], recommendations, &recommendationCount);
                 
                 if (recommendationCount == 0) {
                     printf("No similar commands found. Please try again.\n");
@@ -668,6 +2739,7 @@ int main(int argc, char *argv[]) {
                             for (int k = 0; k < recommendationCount; k++) {
                                 free(recommendations[k]);
                             }
+                            FreeGlobResult(&expanded);
                             free(inputCopy);
                             free(input);
                             Cleanup();
@@ -687,11 +2759,14 @@ int main(int argc, char *argv[]) {
                             char *newCommandCopy = strdup(newCommand);
                             TokenizeUserInput(newCommandCopy, newTokens, &newTokenCount);
                             
-                            int exec_result = ExecuteCommand(newTokens, newTokenCount);
-                            if (exec_result == 1) {
+                            GlobResult newExpanded = {0};
+                            if (ExpandTokens(newTokens, newTokenCount, &newExpanded) < 0) {
+                                printf(COLOR_RED "Brace expansion produces more than %d words\n" COLOR_RESET, MAX_BRACE_EXPANSIONS);
+                            } else if (ExecuteCommand(newExpanded.argv, newExpanded.count) == 1) {
                                 should_exit = 1;
                             }
                             
+                            FreeGlobResult(&newExpanded);
                             free(newCommandCopy);
                             break;
                         } else if (IsNoResponse(userInput)) {
@@ -709,6 +2784,8 @@ int main(int argc, char *argv[]) {
             }
         }
         
+        FreeGlobResult(&expanded);
+        ClearDirListingCache(&globCache);
         free(inputCopy);
         free(input);
     }